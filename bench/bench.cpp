@@ -0,0 +1,458 @@
+/**
+ * bench/bench.cpp
+ * -----------------------------------------------------------------------------
+ * Microbenchmarks of the lexer, parser, evaluator and garbage collector.
+ *
+ * Every benchmark runs once for warming up and then --repeat times. The
+ * median and the minimum time per operation (token, reduction step or object)
+ * are reported together with the objects allocated per operation and the peak
+ * resident memory. Generated inputs use a fixed seed, so the results of two
+ * builds can be compared (--json writes them to a file).
+ *
+ * --scaling measures the costs of lexing, parsing, evaluating and collecting
+ * the generated programs of bench/generator.hpp at increasing sizes instead
+ * (--filter selects the kinds).
+ *
+ * --threads evaluates on a pool of N workers (the evaluator benchmarks then
+ * measure the parallel speedup, compare with --threads 1).
+ *
+ * Usage: bench [--repeat N] [--filter NAME] [--json FILE] [--scaling]
+ *   [--threads N]
+ */
+
+#include "func/func.hpp"
+#include "generator.hpp"
+#include <sstream>
+#include <functional>
+#include <iomanip>
+#include <algorithm>
+#include <sys/resource.h>
+
+#ifndef FUNC_EXAMPLES_DIR
+#define FUNC_EXAMPLES_DIR "examples"
+#endif
+
+//! Measured run of a benchmark
+struct Sample {
+  std::size_t ops; //!< Count of operations
+  double nanoseconds; //!< Time of the measured part
+};
+
+struct Benchmark {
+  std::string name;
+  std::string unit; //!< What is an operation
+  std::function<Sample()> run;
+};
+
+struct Result {
+  std::string name;
+  std::string unit;
+  std::size_t ops; //!< Operations per run
+  std::size_t repeat;
+  double medianNs; //!< Median time per operation
+  double minNs; //!< Minimum time per operation
+  double allocations; //!< Allocated objects per operation
+  std::size_t peakKB; //!< Peak resident memory
+};
+
+//! Costs of a generated program (see measureProgram)
+struct ScalingResult {
+  std::string kind;
+  std::size_t size;
+  std::size_t tokens;
+  double lexNs;
+  double parseNs;
+  double evalNs; //!< Evaluation of all top level expressions
+  double gcNs; //!< Collections after the top level expressions
+  std::size_t steps; //!< Reduction steps
+  std::size_t allocated; //!< Allocated objects
+  std::size_t live; //!< Objects alive at the end
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double nanosecondsSince(Clock::time_point start) noexcept {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+/*!\brief Resets the peak resident memory of the process (Linux only).
+ * \return Returns true on success.
+ */
+static bool resetPeakMemory() noexcept {
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  return clearRefs && (clearRefs << "5").flush();
+}
+
+//!\return Returns the peak resident memory of the process in KiB.
+static std::size_t getPeakMemory() noexcept {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+    if (line.compare(0, 6, "VmHWM:") == 0)
+      return std::strtoull(line.c_str() + 6, nullptr, 10);
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+//!\return Returns count of tokens in source.
+static std::size_t lexAll(const std::string &source) {
+  std::istringstream input(source);
+  std::vector<std::string> lines;
+  Lexer lexer(input, lines);
+
+  std::size_t tokens = 0;
+  Token tok;
+  while ((tok = lexer.nextToken()) != tok_eof && tok != tok_err)
+    ++tokens;
+
+  return tokens;
+}
+
+/*!\brief Scans source like a memory mapped file (without a stream).
+ * \return Returns count of tokens in source.
+ */
+static std::size_t lexBuffer(const std::string &source) {
+  std::vector<std::string> lines;
+  Lexer lexer(source.data(), source.data() + source.size(), lines);
+
+  std::size_t tokens = 0;
+  Token tok;
+  while ((tok = lexer.nextToken()) != tok_eof && tok != tok_err)
+    ++tokens;
+
+  return tokens;
+}
+
+static Sample benchLexer(const std::string &source) {
+  Clock::time_point start = Clock::now();
+  std::size_t tokens = lexAll(source);
+  return Sample{ tokens, nanosecondsSince(start) };
+}
+
+static Sample benchParser(const std::string &source, std::size_t tokens) {
+  std::istringstream input(source);
+  std::vector<std::string> lines;
+  Lexer lexer(input, lines);
+  GCMain gc;
+  Environment *env = new Environment(gc, &lexer);
+
+  Clock::time_point start = Clock::now();
+  while (true) {
+    lexer.nextToken();
+    Expr *expr = parse(gc, lexer, *env);
+    if (!expr && lexer.currentToken() == tok_eof)
+      break;
+    if (!expr && lexer.currentToken() == tok_err) {
+      std::cerr << "Failed parsing the generated input." << std::endl;
+      break;
+    }
+  }
+
+  return Sample{ tokens, nanosecondsSince(start) };
+}
+
+/*!\brief Evaluates expr after interpreting the file example (only the
+ * evaluation is measured).
+ * \param example
+ * \param expr
+ * \param threads Count of workers (no pool if 1).
+ */
+static Sample benchEval(const std::string &example, const std::string &expr,
+    std::size_t threads) {
+  std::vector<std::string> lines;
+  GCMain gc;
+  std::unique_ptr<ThreadPool> pool;
+  if (threads > 1)
+    pool.reset(new ThreadPool(gc, threads));
+
+  Environment *env = new Environment(gc);
+  env->pool = pool.get();
+  std::ifstream input(std::string(FUNC_EXAMPLES_DIR) + "/" + example);
+  if (!input || !interpret(input, gc, lines, env)) {
+    std::cerr << "Failed interpreting \"" << example << "\"." << std::endl;
+    return Sample{ 0, 0 };
+  }
+
+  std::istringstream exprInput(expr);
+  Lexer lexer(exprInput, lines);
+  env->lexer = &lexer;
+  lexer.nextToken();
+  Expr *parsed = parse(gc, lexer, *env);
+  if (!parsed)
+    return Sample{ 0, 0 };
+
+  // Steps of all workers (flushed after every task)
+  std::size_t steps = getReductionSteps();
+  Clock::time_point start = Clock::now();
+  Expr *result = eval(gc, *env, parsed);
+  double nanoseconds = nanosecondsSince(start);
+  if (!result)
+    std::cerr << "Failed evaluating \"" << expr << "\"." << std::endl;
+
+  return Sample{ getReductionSteps() - steps, nanoseconds };
+}
+
+//!\return Returns a balanced tree of 2^depth - 1 objects.
+static Expr *buildTree(GCMain &gc, std::size_t depth) {
+  TokenPos pos(0, 1, 1, 1);
+  if (depth <= 1)
+    return new IntExpr(gc, pos, depth);
+
+  Expr *lhs = buildTree(gc, depth - 1);
+  Expr *rhs = buildTree(gc, depth - 1);
+  return new BiOpExpr(gc, pos, op_add, lhs, rhs);
+}
+
+/*!\brief Marks and sweeps a heap of live objects repeatedly (operation is
+ * a marked object).
+ */
+static Sample benchCollectLive(std::size_t depth, std::size_t collections) {
+  GCMain gc;
+  Environment *env = new Environment(gc);
+  env->ctx.push_back(buildTree(gc, depth));
+  collectGarbage(gc, *env);
+
+  std::size_t objects = gc.getCountObjects();
+  Clock::time_point start = Clock::now();
+  for (std::size_t i = 0; i < collections; ++i)
+    collectGarbage(gc, *env);
+
+  return Sample{ objects * collections, nanosecondsSince(start) };
+}
+
+/*!\brief Allocates short living objects next to a live tree and collects
+ * at safepoints like the evaluator (operation is an allocation).
+ */
+static Sample benchCollectChurn(std::size_t depth, std::size_t count) {
+  GCMain gc;
+  Environment *env = new Environment(gc);
+  env->ctx.push_back(buildTree(gc, depth));
+  TokenPos pos(0, 1, 1, 1);
+
+  Clock::time_point start = Clock::now();
+  for (std::size_t i = 0; i < count; ++i) {
+    StackFrameObj<Expr> garbage(*env, new IntExpr(gc, pos, i));
+    gcSafepoint(gc, *env);
+  }
+
+  return Sample{ count, nanosecondsSince(start) };
+}
+
+/*!\brief Lexes, parses and then interprets the generated program (without
+ * printing the results).
+ */
+static ScalingResult measureProgram(const std::string &kind,
+    std::size_t size) {
+  ScalingResult result;
+  result.kind = kind;
+  result.size = size;
+  result.evalNs = result.gcNs = 0;
+
+  std::string program;
+  generateWorkload(kind, size, program);
+  Sample lexed = benchLexer(program);
+  result.tokens = lexed.ops;
+  result.lexNs = lexed.nanoseconds;
+  result.parseNs = benchParser(program, lexed.ops).nanoseconds;
+
+  std::istringstream input(program);
+  std::vector<std::string> lines;
+  Lexer lexer(input, lines);
+  GCMain gc;
+  Environment *env = new Environment(gc, &lexer);
+
+  std::size_t steps = getReductionSteps();
+  std::size_t allocated = GCMain::getTotalAllocated();
+  while (true) {
+    lexer.nextToken();
+    Expr *expr = parse(gc, lexer, *env);
+    if (!expr && lexer.currentToken() != tok_eol)
+      break;
+    if (!expr)
+      continue;
+
+    Clock::time_point start = Clock::now();
+    if (!eval(gc, *env, expr))
+      std::cerr << "Failed evaluating the generated program." << std::endl;
+    result.evalNs += nanosecondsSince(start);
+
+    start = Clock::now();
+    collectGarbage(gc, *env);
+    result.gcNs += nanosecondsSince(start);
+  }
+
+  result.steps = getReductionSteps() - steps;
+  result.allocated = GCMain::getTotalAllocated() - allocated;
+  result.live = gc.getCountObjects();
+  return result;
+}
+
+static Result measure(const Benchmark &bench, std::size_t repeat) {
+  // Without a reset it is the peak of the process so far
+  resetPeakMemory();
+  bench.run(); // warm up
+
+  std::size_t allocated = GCMain::getTotalAllocated();
+  std::vector<double> nsPerOp;
+  std::size_t ops = 0;
+  for (std::size_t i = 0; i < repeat; ++i) {
+    Sample sample = bench.run();
+    ops = sample.ops;
+    nsPerOp.push_back(sample.ops ? sample.nanoseconds / sample.ops : 0);
+  }
+  allocated = GCMain::getTotalAllocated() - allocated;
+
+  std::sort(nsPerOp.begin(), nsPerOp.end());
+  Result result;
+  result.name = bench.name;
+  result.unit = bench.unit;
+  result.ops = ops;
+  result.repeat = repeat;
+  result.medianNs = nsPerOp[nsPerOp.size() / 2];
+  result.minNs = nsPerOp.front();
+  result.allocations = ops ? double(allocated) / (ops * repeat) : 0;
+  result.peakKB = getPeakMemory();
+  return result;
+}
+
+static void writeJSON(std::ostream &out, const std::vector<Result> &results,
+    const std::vector<ScalingResult> &scaling) {
+  out << "{\n  \"benchmarks\": [";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const Result &result = results[i];
+    out << (i ? ",\n" : "\n")
+      << "    {\"name\": \"" << result.name << "\", "
+      << "\"unit\": \"" << result.unit << "\", "
+      << "\"ops\": " << result.ops << ", "
+      << "\"repeat\": " << result.repeat << ", "
+      << "\"ns_per_op\": " << result.medianNs << ", "
+      << "\"min_ns_per_op\": " << result.minNs << ", "
+      << "\"allocations_per_op\": " << result.allocations << ", "
+      << "\"peak_rss_kb\": " << result.peakKB << "}";
+  }
+  out << "\n  ],\n  \"scaling\": [";
+  for (std::size_t i = 0; i < scaling.size(); ++i) {
+    const ScalingResult &result = scaling[i];
+    out << (i ? ",\n" : "\n")
+      << "    {\"kind\": \"" << result.kind << "\", "
+      << "\"size\": " << result.size << ", "
+      << "\"tokens\": " << result.tokens << ", "
+      << "\"lex_ns\": " << result.lexNs << ", "
+      << "\"parse_ns\": " << result.parseNs << ", "
+      << "\"eval_ns\": " << result.evalNs << ", "
+      << "\"gc_ns\": " << result.gcNs << ", "
+      << "\"steps\": " << result.steps << ", "
+      << "\"allocated\": " << result.allocated << ", "
+      << "\"live\": " << result.live << "}";
+  }
+  out << "\n  ]\n}" << std::endl;
+}
+
+int main(int vargsc, char * vargs[]) {
+  std::size_t repeat = 5;
+  std::string filter;
+  const char *jsonFile = nullptr;
+  bool scaling = false;
+  std::size_t threads = 1;
+  for (int i = 1; i < vargsc; ++i) {
+    std::string arg = vargs[i];
+    if (arg == "--repeat" && i + 1 < vargsc)
+      repeat = std::max(1, std::atoi(vargs[++i]));
+    else if (arg == "--filter" && i + 1 < vargsc)
+      filter = vargs[++i];
+    else if (arg == "--json" && i + 1 < vargsc)
+      jsonFile = vargs[++i];
+    else if (arg == "--scaling")
+      scaling = true;
+    else if (arg == "--threads" && i + 1 < vargsc)
+      threads = std::max(1, std::atoi(vargs[++i]));
+    else {
+      std::cerr << "Usage: " << vargs[0]
+        << " [--repeat N] [--filter NAME] [--json FILE] [--scaling]"
+        << " [--threads N]" << std::endl;
+      return 1;
+    }
+  }
+
+  const std::string definitions = generateDefinitions(5000);
+  std::string deep;
+  for (std::size_t i = 0; i < 20; ++i)
+    deep += generateNested(100) + "\n" + generateChain(100) + "\n";
+  const std::size_t definitionTokens = lexAll(definitions);
+  const std::size_t deepTokens = lexAll(deep);
+
+  std::vector<Benchmark> benchmarks = {
+    { "lex_definitions", "token",
+      [&]() { return benchLexer(definitions); } },
+    { "lex_definitions_buffer", "token",
+      [&]() {
+        Clock::time_point start = Clock::now();
+        std::size_t tokens = lexBuffer(definitions);
+        return Sample{ tokens, nanosecondsSince(start) };
+      } },
+    { "parse_definitions", "token",
+      [&]() { return benchParser(definitions, definitionTokens); } },
+    { "parse_deep", "token",
+      [&]() { return benchParser(deep, deepTokens); } },
+    { "eval_fib", "step",
+      [threads]() { return benchEval("fib", "fib 15", threads); } },
+    { "eval_peano", "step",
+      [threads]() { return benchEval("numbers",
+          "eq (mul ten ten) (mul five (add ten ten))", threads); } },
+    { "gc_live", "object",
+      []() { return benchCollectLive(17, 10); } },
+    { "gc_churn", "object",
+      []() { return benchCollectChurn(12, 200000); } },
+  };
+
+  std::vector<Result> results;
+  std::vector<ScalingResult> scalingResults;
+  for (const std::string &kind : getWorkloadKinds()) {
+    if (!scaling || kind.find(filter) == std::string::npos)
+      continue;
+
+    // Definitions are cheap, the others grow at least quadratically
+    std::size_t size = kind == "definitions" ? 250 : 25;
+    for (int i = 0; i < 5; ++i, size *= 2) {
+      ScalingResult result = measureProgram(kind, size);
+      std::cout << std::left << std::setw(12) << result.kind << std::right
+        << std::setw(6) << result.size << ": " << std::fixed
+        << std::setprecision(0)
+        << "lex " << result.lexNs << " ns, parse " << result.parseNs
+        << " ns, eval " << result.evalNs << " ns, gc " << result.gcNs
+        << " ns, " << result.steps << " steps, " << result.allocated
+        << " allocated, " << result.live << " live" << std::endl;
+      scalingResults.push_back(result);
+    }
+  }
+
+  for (const Benchmark &bench : benchmarks) {
+    if (scaling)
+      break;
+
+    if (bench.name.find(filter) == std::string::npos)
+      continue;
+
+    Result result = measure(bench, repeat);
+    std::cout << std::left << std::setw(23) << result.name << std::right
+      << std::fixed << std::setprecision(2)
+      << std::setw(10) << result.medianNs << " ns/" << result.unit
+      << " (min " << result.minNs << "), "
+      << result.allocations << " allocations/" << result.unit
+      << ", peak " << result.peakKB << " KiB" << std::endl;
+    results.push_back(result);
+  }
+
+  if (jsonFile) {
+    std::ofstream output(jsonFile);
+    if (!output) {
+      std::cerr << "Failed opening file \"" << jsonFile << "\"." << std::endl;
+      return 1;
+    }
+    writeJSON(output, results, scalingResults);
+  }
+
+  return 0;
+}
@@ -0,0 +1,33 @@
+/**
+ * bench/generate.cpp
+ * -----------------------------------------------------------------------------
+ * Writes a synthetic program of the given kind and size to stdout (see
+ * bench/generator.hpp). Without arguments the kinds are listed.
+ *
+ * Usage: generate [<kind> <size>]
+ */
+
+#include "generator.hpp"
+#include <iostream>
+#include <cstdlib>
+
+int main(int vargsc, char * vargs[]) {
+  if (vargsc == 1) {
+    for (const std::string &kind : getWorkloadKinds())
+      std::cout << kind << std::endl;
+    return 0;
+  }
+
+  if (vargsc != 3)
+    return 1;
+
+  std::string program;
+  if (!generateWorkload(vargs[1], std::strtoull(vargs[2], nullptr, 10),
+        program)) {
+    std::cerr << "Unknown kind \"" << vargs[1] << "\"." << std::endl;
+    return 1;
+  }
+
+  std::cout << program;
+  return 0;
+}
@@ -0,0 +1,118 @@
+#include "generator.hpp"
+
+#include <sstream>
+#include <random>
+#include <functional>
+
+std::string generateDefinitions(std::size_t count) {
+  std::mt19937 random(42);
+  const char *operators[] = { "+", "-", "*", "/", "==", "<" };
+  const char *vars[] = { "x", "y", "z" };
+
+  std::function<void(std::ostream&, int)> genExpr
+    = [&](std::ostream &out, int depth) {
+    std::size_t choice = random() % 8;
+    if (depth == 0 || choice < 2)
+      out << random() % 1000;
+    else if (choice < 4)
+      out << vars[random() % 3];
+    else if (choice == 4)
+      out << random() % 100 << "." << random() % 100;
+    else if (choice == 5) {
+      out << "(";
+      genExpr(out, depth - 1);
+      out << ")";
+    } else {
+      genExpr(out, depth - 1);
+      out << " " << operators[random() % 6] << " ";
+      genExpr(out, depth - 1);
+    }
+  };
+
+  std::ostringstream out;
+  for (std::size_t i = 0; i < count; ++i) {
+    out << "f" << i << " x y z = ";
+    genExpr(out, 5);
+    if (i % 4 == 0)
+      out << " -- comment " << i;
+    out << "\n";
+  }
+
+  return out.str();
+}
+
+std::string generateNested(std::size_t depth) {
+  std::ostringstream out;
+  out << std::string(depth, '(') << "0";
+  for (std::size_t i = 0; i < depth; ++i)
+    out << " + " << i + 1 << ")";
+
+  return out.str();
+}
+
+std::string generateChain(std::size_t length) {
+  std::ostringstream out;
+  out << "0";
+  for (std::size_t i = 0; i < length; ++i)
+    out << " * " << i + 1;
+
+  return out.str();
+}
+
+std::string generateCases(std::size_t count) {
+  std::ostringstream out;
+  for (std::size_t i = 0; i < count; ++i)
+    out << "f " << i << " = " << i * 2 << "\n";
+  out << "f x = x\n"
+    << "f " << (count ? count - 1 : 0) << "\n";
+
+  return out.str();
+}
+
+std::string generateSuccChain(std::size_t length) {
+  std::ostringstream out;
+  out << "add (.succ x) y = .succ (add x y)\n"
+    << "add .zero y     = y\n"
+    << "n = ";
+  for (std::size_t i = 0; i < length; ++i)
+    out << ".succ (";
+  out << ".zero" << std::string(length, ')') << "\n"
+    << "add n n\n";
+
+  return out.str();
+}
+
+std::string generateLet(std::size_t width) {
+  std::ostringstream out;
+  out << "let x0 = 0";
+  for (std::size_t i = 1; i < width; ++i)
+    out << "; x" << i << " = x" << i - 1 << " + 1";
+  out << " in x" << (width ? width - 1 : 0) << "\n";
+
+  return out.str();
+}
+
+const std::vector<std::string> &getWorkloadKinds() noexcept {
+  static const std::vector<std::string> kinds = {
+    "definitions", "nested", "cases", "succ", "let"
+  };
+  return kinds;
+}
+
+bool generateWorkload(const std::string &kind, std::size_t size,
+    std::string &program) {
+  if (kind == "definitions")
+    program = generateDefinitions(size);
+  else if (kind == "nested")
+    program = generateNested(size) + "\n" + generateChain(size) + "\n";
+  else if (kind == "cases")
+    program = generateCases(size);
+  else if (kind == "succ")
+    program = generateSuccChain(size);
+  else if (kind == "let")
+    program = generateLet(size);
+  else
+    return false;
+
+  return true;
+}
@@ -0,0 +1,60 @@
+#ifndef FUNC_BENCH_GENERATOR_HPP
+#define FUNC_BENCH_GENERATOR_HPP
+
+/*!\file bench/generator.hpp
+ * \brief Synthetic programs of controllable size (for scaling studies).
+ *
+ * All generators are deterministic: The same size always results in the same
+ * program.
+ */
+
+#include <string>
+#include <vector>
+
+/*!\return Returns count lines of definitions like "f12 x y z = (x + 3) * y"
+ * (random expressions with a fixed seed, some with comments).
+ */
+std::string generateDefinitions(std::size_t count);
+
+/*!\return Returns an expression of depth nested parentheses like
+ * "((0 + 1) + 2)".
+ */
+std::string generateNested(std::size_t depth);
+
+/*!\return Returns an expression of length operators like "0 * 1 * 2".
+ */
+std::string generateChain(std::size_t length);
+
+/*!\return Returns a function with count pattern cases and its application
+ * to the last case (all cases are matched).
+ */
+std::string generateCases(std::size_t count);
+
+/*!\return Returns a number of length nested .succ atoms and the addition of
+ * it to itself.
+ */
+std::string generateSuccChain(std::size_t length);
+
+/*!\return Returns a let block of width bindings, every binding uses the
+ * previous one.
+ */
+std::string generateLet(std::size_t width);
+
+/*!\return Returns the names of the kinds of generateWorkload.
+ */
+const std::vector<std::string> &getWorkloadKinds() noexcept;
+
+/*!\brief Generates a program of kind (see getWorkloadKinds):
+ *
+ * - definitions: generateDefinitions(size)
+ * - nested: generateNested(size) and generateChain(size)
+ * - cases: generateCases(size)
+ * - succ: generateSuccChain(size)
+ * - let: generateLet(size)
+ *
+ * \return Returns false if kind is unknown.
+ */
+bool generateWorkload(const std::string &kind, std::size_t size,
+    std::string &program);
+
+#endif /* FUNC_BENCH_GENERATOR_HPP */
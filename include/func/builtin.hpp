@@ -0,0 +1,87 @@
+#ifndef FUNC_BUILTIN_HPP
+#define FUNC_BUILTIN_HPP
+
+/*!\file func/builtin.hpp
+ * \brief Builtin functions (error, print, to_int, round_int, time, benchmark,
+ * spawn, await, heap_dump).
+ */
+
+#include "func/global.hpp"
+#include "func/syntax.hpp"
+
+/*!\brief Implementation of a builtin function.
+ * \param gc
+ * \param env
+ * \param pos Position of the application.
+ * \param args Evaluated leading arguments (arity - 1, like natives).
+ * \param arg Last argument (not evaluated).
+ * \return Returns the result, nullptr on error.
+ */
+typedef Expr *(*BuiltinFn)(GCMain &gc, Environment &env,
+    const TokenPos &pos, const std::vector<Value> &args, Expr *arg);
+
+/*!\brief Native C++ function.
+ * \param gc
+ * \param env
+ * \param pos Position of the application (for reporting errors).
+ * \param args Evaluated arguments (ints, nums, .true and .false unboxed).
+ * \return Returns the result. Value() is an error (report it with
+ * reportSyntaxError, which returns nullptr).
+ */
+typedef std::function<Value(GCMain &gc, Environment &env,
+    const TokenPos &pos, const std::vector<Value> &args)> NativeFn;
+
+/*!\brief Entry of the builtin table.
+ */
+struct Builtin {
+  std::string name;
+  BuiltinFn fn; //!< Called with the unevaluated last argument (or nullptr)
+  std::size_t arity; //!< Count of arguments of fn or native
+  NativeFn native; //!< Called after arity arguments were applied
+  //! fn has side effects (not called by speculative evaluations)
+  bool effects = false;
+};
+
+/*!\return Returns builtin called name, nullptr if there is none.
+ */
+const Builtin *findBuiltin(const std::string &name) noexcept;
+
+/*!\brief Adds fn as builtin called name to the builtin table (replaces an
+ * existing builtin with the same name). fn may have side effects, so
+ * speculative evaluations don't call it.
+ */
+void addBuiltin(const std::string &name, BuiltinFn fn) noexcept;
+
+/*!\brief Registers a native C++ function as builtin called name (replaces
+ * an existing builtin with the same name). Must be called before parsing
+ * expressions using it.
+ *
+ * Every argument is evaluated when applied. Applications with less than
+ * arity arguments evaluate to partially applied natives.
+ *
+ *     registerNative("hypot", 2, [](GCMain &gc, Environment &env,
+ *         const TokenPos &pos, const std::vector<Value> &args) {
+ *       if (!args[0].isNum() || !args[1].isNum())
+ *         return Value(reportSyntaxError(*env.lexer, "Numbers expected.", pos));
+ *
+ *       return Value::fromNum(std::hypot(args[0].getNum(), args[1].getNum()));
+ *     });
+ *
+ * \param name Identifier of the function.
+ * \param arity Count of arguments (at least 1).
+ * \param native Implementation.
+ * \return Returns false if arity is 0.
+ */
+bool registerNative(const std::string &name, std::size_t arity,
+    NativeFn native) noexcept;
+
+/*!\return Returns expr, where identifiers of builtins are replaced by
+ * BuiltinExpr. Identifiers bound by lambda functions, let expressions,
+ * function parameters or the environment aren't replaced.
+ * \param gc
+ * \param env
+ * \param expr Top level expression.
+ */
+Expr *resolveBuiltins(GCMain &gc, Environment &env, Expr *expr) noexcept;
+
+#endif /* FUNC_BUILTIN_HPP */
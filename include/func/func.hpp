@@ -4,6 +4,12 @@
 #include "func/global.hpp"
 #include "func/lexer.hpp"
 #include "func/syntax.hpp"
+#include "func/optimizer.hpp"
+#include "func/parallel.hpp"
+#include "func/profiler.hpp"
+#include "func/trace.hpp"
+#include "func/resumable.hpp"
+#include "func/sampler.hpp"
 #include "func/parser.hpp"
 
 /*!\file func/func.hpp
@@ -107,11 +113,28 @@
  * \parm env If nullptr: create new one.
  * \param input
  * \param interpret_mode Prints some pretty helpers (line prefixes) if true.
+ * \param limits Limits of the evaluation of every top level expression.
+ *
+ * The evaluation of a top level expression can be interrupted by
+ * interruptEvaluation (e.g. from another thread). Then the next expression
+ * is interpreted.
  * \return Returns true on success, false if error occured.
  */
 bool interpret(std::istream &input, GCMain &gc,
     std::vector<std::string> &lines,
     Environment *env = nullptr,
-    bool interpret_mode = false) noexcept;
+    bool interpret_mode = false,
+    const EvalLimits &limits = EvalLimits()) noexcept;
+
+/*!\brief Interpret a memory mapped file (like interpret).
+ *
+ * The file is scanned directly (no stream, identifiers aren't copied until
+ * parsed), which is faster for large files.
+ * \return Returns true on success, false if error occured.
+ */
+bool interpret(const MappedFile &file, GCMain &gc,
+    std::vector<std::string> &lines,
+    Environment *env = nullptr,
+    const EvalLimits &limits = EvalLimits()) noexcept;
 
 #endif /* FUNC_FUNC_HPP */
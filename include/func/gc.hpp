@@ -9,6 +9,16 @@
 
 class GCObj;
 class GCMain;
+class Tracer;
+
+/*!\brief Objects allocated by one thread since the last collection.
+ * \see GCMain::attachThread
+ */
+struct GCThreadBuffer {
+  GCMain *gc; //!< Collector the buffer belongs to
+  std::vector<GCObj*> objs; //!< New objects (not yet in GCMain::marks)
+  std::size_t countNewObjs = 0;
+};
 
 /*!\brief Garbage collection object (objects to collect).
  */
@@ -28,6 +38,40 @@ public:
 
   //!\brief If not marked mark itself and children.
   virtual void mark(GCMain &main) noexcept;
+
+  //!\return Returns name of the type (for heap dumps).
+  virtual std::string getTypeName() const noexcept { return "object"; }
+
+  /*!\return Returns size in bytes (for heap dumps, without owned strings
+   * and containers).
+   */
+  virtual std::size_t getSize() const noexcept { return sizeof(GCObj); }
+
+  /*!\return Returns where the object was created ("" if unknown, for heap
+   * dumps).
+   */
+  virtual std::string getSite() const noexcept { return ""; }
+};
+
+/*!\brief Count and size of live objects by type and by allocation site.
+ * \see GCMain::requestHeapDump
+ */
+struct HeapHistogram {
+  struct Entry {
+    std::size_t count = 0;
+    std::size_t bytes = 0;
+  };
+
+  std::map<std::string, Entry> types;
+  std::map<std::string, Entry> sites; //!< Empty if sites weren't requested
+
+  /*!\brief Counts obj (by its site, too, if sites is true).
+   */
+  void add(const GCObj &obj, bool sites) noexcept;
+
+  /*!\brief Prints types and the maxSites sites with the most bytes.
+   */
+  void print(std::ostream &out, std::size_t maxSites = 20) const;
 };
 
 /*!\brief Implements a tracing garbage collector.
@@ -38,10 +82,63 @@ class GCMain {
 
   //! All objects available.
   std::vector<GCObj*> marks;
+  //! Indices of the free (nullptr) entries in marks
+  std::vector<std::size_t> freeSlots;
+
+  Tracer *tracer = nullptr; //!< Trace of collections (may be nullptr)
+  //! Start of marking (see beginMark)
+  std::chrono::steady_clock::time_point markStart;
+  bool marking = false; //!< beginMark was called
+
+  //! Requested heap dump (0 none, 1 types, 2 types and sites)
+  std::atomic<int> heapDump{0};
+
+  std::size_t maxObjects = 0; //!< Heap cap (0 means unlimited)
+  //! Count of objects after the last collect
+  std::atomic<std::size_t> countLiveObjs{0};
+  std::size_t peakLiveObjs = 0; //!< Maximum of countLiveObjs
+  std::size_t countCollections = 0; //!< Count of collect calls
+  //! Time spent collecting (from beginMark or collect)
+  std::chrono::steady_clock::duration collectTime{0};
+
+  //! Pointers to additional roots (see addRoot)
+  std::set<GCObj *const*> roots;
+
+  std::mutex buffersMutex; //!< Guards buffers
+  //! Allocation buffers of attached threads
+  std::list<GCThreadBuffer> buffers;
+
+  /*!\brief Moves obj to marks (reuses free slots).
+   */
+  void insert(GCObj *obj);
 public:
-  GCMain() : markBit(true), marks() {}
+  GCMain() : markBit(true), countNewObjs(0), marks() {}
   virtual ~GCMain();
 
+  /*!\brief Lets the calling thread allocate into an own buffer.
+   *
+   * Required for every thread (except the one, which created the collector)
+   * that allocates objects. The buffers are merged by collect, so collect
+   * must only be called while no other thread allocates (stop the world).
+   */
+  void attachThread();
+
+  /*!\brief Merges the buffer of the calling thread.
+   * \see attachThread
+   */
+  void detachThread();
+
+  /*!\brief Lets collect mark *root (if not nullptr) until removeRoot.
+   *
+   * For roots of suspended computations, which aren't reachable from the
+   * environment of the collecting thread.
+   */
+  void addRoot(GCObj *const *root);
+
+  /*!\brief Removes a root added by addRoot.
+   */
+  void removeRoot(GCObj *const *root);
+
   /*!\return Returns status of the mark bit.
    *
    * This is a 'hack'. Otherwise the algorithm would be force to reset the
@@ -50,20 +147,86 @@ public:
    */
   bool getMarkBit() const noexcept;
 
-  /*!\return Returns count of new objects since last collect call.
+  /*!\return Returns count of new objects since last collect call (of the
+   * calling thread, if attached).
    * \see collect
    */
   std::size_t getCountNewObjects() const noexcept;
 
+  /*!\return Returns count of objects allocated by the calling thread since
+   * its start (of all collectors).
+   */
+  static std::size_t getCountAllocated() noexcept;
+
+  /*!\return Returns count of objects allocated by all threads (allocations
+   * of other threads are added by flushCountAllocated).
+   */
+  static std::size_t getTotalAllocated() noexcept;
+
+  /*!\brief Adds the allocations of the calling thread to getTotalAllocated
+   * (e.g. after every task of a thread pool).
+   */
+  static void flushCountAllocated() noexcept;
+
+  /*!\brief Sets the maximum count of objects (0 means unlimited).
+   *
+   * The collector doesn't enforce it. Evaluations check exceedsLimit (after
+   * collecting) and abort.
+   */
+  void setMaxObjects(std::size_t max) noexcept { maxObjects = max; }
+
+  //!\return Returns the maximum count of objects (0 means unlimited).
+  std::size_t getMaxObjects() const noexcept { return maxObjects; }
+
+  /*!\return Returns count of objects alive at the last collect plus the new
+   * objects (of the calling thread, if attached).
+   */
+  std::size_t getCountObjects() const noexcept;
+
+  /*!\return Returns the maximum count of objects alive after a collect.
+   */
+  std::size_t getPeakObjects() const noexcept { return peakLiveObjs; }
+
+  //!\return Returns count of collections.
+  std::size_t getCountCollections() const noexcept { return countCollections; }
+
+  //!\return Returns milliseconds spent collecting (marking and sweeping).
+  double getCollectTime() const noexcept {
+    return std::chrono::duration<double, std::milli>(collectTime).count();
+  }
+
+  /*!\return Returns true if there are more objects than allowed.
+   * \see setMaxObjects
+   */
+  bool exceedsLimit() const noexcept {
+    return maxObjects > 0 && getCountObjects() > maxObjects;
+  }
+
   /*!\brief Adds obj to all objects available.
    * \param obj
    */
   void add(GCObj *obj);
 
+  /*!\brief Writes the mark and sweep phases of collections to tracer (may
+   * be nullptr).
+   */
+  void setTracer(Tracer *tracer) noexcept { this->tracer = tracer; }
+
+  /*!\brief The next collect prints a histogram of the live objects to
+   * std::cerr. Async-signal-safe.
+   * \param sites Count objects by allocation site, too.
+   */
+  void requestHeapDump(bool sites = false) noexcept;
+
+  /*!\brief Marks the start of a collection (roots are marked next, for the
+   * trace and getCollectTime).
+   */
+  void beginMark() noexcept;
+
   /*!\brief Collects garbage.
    *
-   * Use mark function of directly reachable objects (roots).
-   * Resets getCountNewObjects to 0.
+   * Use mark function of directly reachable objects (roots). Roots added by
+   * addRoot are marked by collect. Resets getCountNewObjects to 0 (for all threads).
    */ 
   void collect();
 };
@@ -5,15 +5,26 @@
  * \brief File for managing external headers.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cmath>
 #include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 #endif /* FUNC_GLOBAL_HPP */
@@ -93,6 +93,32 @@ namespace std {
  */
 int getOperatorPrecedence(Operator op);
 
+/*!\brief Read-only memory mapping of a file (source of a Lexer).
+ */
+class MappedFile {
+  char *data = nullptr;
+  std::size_t size = 0;
+  bool opened = false;
+public:
+  /*!\brief Maps the file filename (check isOpen). Fails for everything but
+   * regular files (e.g. pipes), which have to be streamed.
+   */
+  MappedFile(const std::string &filename);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator =(const MappedFile &) = delete;
+
+  //!\return Returns true if the file was mapped.
+  bool isOpen() const noexcept { return opened; }
+
+  //!\return Returns the first character (nullptr if the file is empty).
+  const char *begin() const noexcept { return data; }
+
+  //!\return Returns the end of the file.
+  const char *end() const noexcept { return data + size; }
+};
+
 class Lexer {
   std::size_t line;
   std::size_t column;
@@ -103,16 +129,37 @@ class Lexer {
   Operator curop;
   double curnum;
   int64_t curint;
-  std::string curid;
+  mutable std::string curid; //!< Copy of curidView (see currentIdentifier)
+  mutable bool curidCopied = true;
+  std::string_view curidView;
 
   int curchar;
 
-  std::istream *input;
+  std::istream *input; //!< nullptr if the source is a buffer
+
+  //! Buffer mode: Source and the next character to scan
+  const char *source = nullptr, *cursor = nullptr, *sourceEnd = nullptr;
+  //! Buffer mode: Offset of the first line not in lines yet (see fillLines)
+  std::size_t linesOffset = 0;
 
   size_t token_start, token_end;
   std::vector<std::string>& lines;
+
+  /*!\brief Buffer mode: Adds the lines read so far to lines.
+   */
+  void fillLines();
 public:
   Lexer(std::istream &input, std::vector<std::string> &lines);
+
+  /*!\brief Scans the buffer [begin, end) directly (must live longer than the
+   * lexer).
+   *
+   * Identifiers are slices of the buffer (see currentIdentifierView). The
+   * source lines are only added to lines on errors, by getLines and by the
+   * destructor.
+   */
+  Lexer(const char *begin, const char *end, std::vector<std::string> &lines);
+
   virtual ~Lexer();
 
   /*!\brief Aquire next char.
@@ -162,7 +209,7 @@ public:
   size_t getTokenEndPos() const noexcept
     { return curchar < 0 || curchar == '\n' ? token_end :
       (token_end == 0 ? 0 : token_end - 1); }
-  const std::vector<std::string> &getLines() { return lines; }
+  const std::vector<std::string> &getLines() { fillLines(); return lines; }
 
   TokenPos getTokenPos() const noexcept {
     return TokenPos(getTokenStartPos(), getTokenEndPos(),
@@ -174,6 +221,11 @@ public:
    */
   const std::string &currentIdentifier() const noexcept;
 
+  /*!\return Returns identifier like currentIdentifier without copying it
+   * (valid until the next nextToken call).
+   */
+  std::string_view currentIdentifierView() const noexcept { return curidView; }
+
   /*!\brief Returns precedence of current token.
    */
   int currentPrecedence();
@@ -0,0 +1,104 @@
+#ifndef FUNC_OPTIMIZER_HPP
+#define FUNC_OPTIMIZER_HPP
+
+/*!\file func/optimizer.hpp
+ * \brief Pass based optimizer (run on top level expressions after parsing).
+ */
+
+#include "func/global.hpp"
+#include "func/syntax.hpp"
+
+/*!\brief Identifiers bound by lambda functions, let expressions and
+ * function parameters around the currently optimized expression.
+ */
+typedef std::vector<std::string> Scope;
+
+/*!\return Returns true if name is bound in scope.
+ */
+bool isBound(const Scope &scope, const std::string &name) noexcept;
+
+/*!\brief One optimization pass.
+ *
+ * A pass rewrites the expression tree bottom-up: rewrite is called for
+ * every node after its children have been optimized.
+ */
+class OptimizerPass {
+  double consumedTime = 0.0; //!< Milliseconds spent in pass
+protected:
+  std::size_t rewrites = 0; //!< Count of changed nodes
+
+  /*!\brief Rewrites one node (children are already optimized).
+   * \param gc
+   * \param env Environment of top level identifiers.
+   * \param expr Node to rewrite.
+   * \param scope Identifiers bound around expr.
+   * \return Returns expr if nothing changed, otherwise the new expression.
+   */
+  virtual Expr *rewrite(GCMain &gc, Environment &env, Expr *expr,
+      const Scope &scope) noexcept {
+    return expr;
+  }
+
+  /*!\brief Applies rewrite to expr and all of its children.
+   */
+  Expr *transform(GCMain &gc, Environment &env, Expr *expr, Scope &scope) noexcept;
+
+  /*!\return Returns optimized top level expression (default: transform).
+   */
+  virtual Expr *apply(GCMain &gc, Environment &env, Expr *expr) noexcept;
+
+public:
+  virtual ~OptimizerPass() {}
+
+  //!\return Returns the name of the pass (used for statistics).
+  virtual const char *getName() const noexcept = 0;
+
+  /*!\return Returns optimized expr (measures time spent in apply).
+   * \param gc
+   * \param env
+   * \param expr
+   */
+  Expr *run(GCMain &gc, Environment &env, Expr *expr) noexcept;
+
+  //!\return Returns count of rewritten nodes.
+  std::size_t getRewrites() const noexcept { return rewrites; }
+
+  //!\return Returns milliseconds spent in this pass.
+  double getConsumedTime() const noexcept { return consumedTime; }
+};
+
+/*!\brief Runs optimization passes depending on the optimization level.
+ *
+ * - 0: No optimizations.
+ * - 1: Constant folding, '&&'/'||' folding, removing dead let bindings,
+ *      sharing equal subtrees (Expr::optimize).
+ * - 2: Additionally specialization of named functions applied to constant
+ *      arguments, beta-reduction of literal lambda functions and inlining
+ *      small non-recursive named functions.
+ */
+class Optimizer {
+  int level;
+  std::vector<std::unique_ptr<OptimizerPass>> passes;
+public:
+  /*!\param level Optimization level.
+   * \param typeCheck Infers types (reports type errors) if true.
+   * \see TypeInferencePass
+   */
+  Optimizer(int level = 1, bool typeCheck = false);
+
+  //!\return Returns the optimization level.
+  int getLevel() const noexcept { return level; }
+
+  /*!\return Returns expr optimized by all passes, nullptr on type errors.
+   * \param gc
+   * \param env Environment to lookup named functions.
+   * \param expr Top level expression.
+   */
+  Expr *run(GCMain &gc, Environment &env, Expr *expr) noexcept;
+
+  /*!\brief Prints statistics of every pass.
+   */
+  void printStatistics(std::ostream &out) const;
+};
+
+#endif /* FUNC_OPTIMIZER_HPP */
@@ -0,0 +1,253 @@
+#ifndef FUNC_PARALLEL_HPP
+#define FUNC_PARALLEL_HPP
+
+/*!\file func/parallel.hpp
+ * \brief Parallel evaluation of independent operands (work stealing).
+ */
+
+#include "func/global.hpp"
+#include "func/syntax.hpp"
+
+/*!\brief Evaluation of an operand, which may be stolen by another worker.
+ */
+struct EvalTask {
+  Expr *expr;
+  Environment *env; //!< Environment of the spawning worker
+  EvalBudget *budget; //!< Budget of the spawning evaluation (may be nullptr)
+  const EvalTask *parent; //!< Task of the spawning worker (may be nullptr)
+  bool speculative = false; //!< Result may be unneeded (errors not reported)
+  std::atomic<bool> cancelled{false}; //!< Result isn't needed anymore
+  Value result; //!< Valid if done
+  std::atomic<bool> done{false};
+};
+
+/*!\brief Value of an expression evaluated concurrently (result of spawn).
+ *
+ * The expression is evaluated by any worker of the pool. Without a pool it
+ * is evaluated immediately.
+ */
+class FutureExpr : public Expr {
+  EvalTask task;
+public:
+  FutureExpr(GCMain &gc, const TokenPos &pos, Expr *expr,
+      Environment &env) noexcept;
+
+  virtual ~FutureExpr() {}
+
+  //!\return Returns the spawned expression.
+  const Expr &getExpression() const noexcept { return *task.expr; }
+
+  //!\return Returns true if the value is available.
+  bool isDone() const noexcept {
+    return task.done.load(std::memory_order_acquire);
+  }
+
+  /*!\return Returns the value (converts to false on error or if not done).
+   */
+  const Value &getValue() const noexcept { return task.result; }
+
+  //!\return Returns the evaluation (queued by ThreadPool::submit).
+  EvalTask &getTask() noexcept { return task; }
+
+  /*!\brief Evaluates the expression on the calling thread.
+   */
+  void evaluate(GCMain &gc) noexcept;
+
+  virtual std::string toString() const noexcept override {
+    return "spawn (" + task.expr->toString() + ")";
+  }
+
+  //!\brief Mark self, the expression, its environment and the value.
+  virtual void mark(GCMain &gc) noexcept override;
+
+  virtual bool equals(const Expr *expr, bool exact = false) const noexcept override;
+};
+
+/*!\brief Fork-join thread pool with work stealing.
+ *
+ * Every worker has an own deque of tasks. The owner pushes and pops at the
+ * back, other workers steal from the front. The thread creating the pool is
+ * worker 0.
+ *
+ * Garbage is collected while all other workers are stopped (at a safepoint,
+ * joining or idle). Their environments are the roots.
+ * \see gcSafepoint
+ */
+class ThreadPool {
+  struct Worker {
+    std::mutex mutex; //!< Guards tasks
+    std::deque<EvalTask*> tasks;
+    std::vector<EvalTask*> outstanding; //!< Spawned, but not joined
+    std::vector<Environment*> envs; //!< Environments of stopped evaluations
+    std::thread thread;
+  };
+
+  GCMain &gc;
+  std::vector<std::unique_ptr<Worker>> workers;
+  bool parallelGuards = false;
+
+  std::atomic<bool> stopping{false}; //!< Workers should exit
+  std::atomic<std::size_t> queued{0}; //!< Count of tasks in all deques
+  //! Count of workers waiting for tasks (or for a task to finish)
+  std::atomic<std::size_t> idle{0};
+  std::mutex idleMutex;
+  std::condition_variable idleCV; //!< Notified on new and finished tasks
+
+  std::mutex futuresMutex; //!< Guards futures
+  std::list<FutureExpr*> futures; //!< Submitted futures (roots until done)
+
+  std::mutex gcMutex; //!< Guards active and the stop of the world
+  std::condition_variable gcCV;
+  std::size_t active; //!< Count of workers, which may allocate
+  std::atomic<bool> stopRequested{false}; //!< A worker waits to collect
+
+  void workerLoop(Worker *self) noexcept;
+
+  /*!\brief Worker stops allocating (env is a root while stopped).
+   */
+  void leave(Worker *self, Environment *env) noexcept;
+
+  /*!\brief Worker continues (waits for a running collection).
+   */
+  void enter(Worker *self, Environment *env) noexcept;
+
+  /*!\return Returns a task of self (newest) or of another worker (oldest),
+   * nullptr if there is none.
+   */
+  EvalTask *steal(Worker *self) noexcept;
+
+  /*!\return Returns true if task was removed from the deque of self (not
+   * stolen).
+   */
+  bool take(Worker *self, EvalTask *task) noexcept;
+
+  /*!\brief Pushes task to the deque of self.
+   */
+  void spawn(Worker *self, EvalTask *task) noexcept;
+
+  void run(EvalTask *task) noexcept;
+
+  void join(Environment &env, EvalTask &task) noexcept;
+
+  void markRoots() noexcept;
+
+  /*!\return Returns true if more workers wait for tasks than there are
+   * queued tasks (granularity cutoff: tasks are only created on demand).
+   */
+  bool hasIdleWorkers() const noexcept;
+public:
+  /*!\brief Starts threads - 1 workers.
+   * \param gc
+   * \param threads Count of workers including the calling thread.
+   */
+  ThreadPool(GCMain &gc, std::size_t threads);
+  ~ThreadPool();
+
+  //!\return Returns count of workers (including the creating thread).
+  std::size_t getThreads() const noexcept { return workers.size(); }
+
+  /*!\brief Enables speculative evaluation of the guards of function cases.
+   * \see evalFirst
+   */
+  void setParallelGuards(bool enable) noexcept { parallelGuards = enable; }
+
+  //!\return Returns true if guards are evaluated in parallel.
+  bool getParallelGuards() const noexcept { return parallelGuards; }
+
+  /*!\return Returns true if lhs and rhs should be evaluated in parallel.
+   *
+   * Only unevaluated function applications are worth a task and only if a
+   * worker waits for one.
+   */
+  bool shouldSpawn(const Expr *lhs, const Expr *rhs) const noexcept;
+
+  /*!\brief Evaluates lhs and rhs (rhs maybe by another worker).
+   *
+   * rhs isn't evaluated if lhs failed and rhs wasn't stolen.
+   */
+  void evalBoth(GCMain &gc, Environment &env, Expr *lhs, Expr *rhs,
+      Value &lhsval, Value &rhsval) noexcept;
+
+  /*!\return Returns true if the conditions should be evaluated in
+   * parallel (one of the later conditions applies a function).
+   */
+  bool shouldSpeculate(const std::vector<Expr*> &conditions) const noexcept;
+
+  /*!\brief Evaluates conditions speculatively in parallel.
+   * \param gc
+   * \param env
+   * \param conditions Conditions in priority order.
+   * \param result Value of the returned condition.
+   * \return Returns index of the first condition, which didn't evaluate to
+   * .false (conditions.size() if there is none). The evaluation of the
+   * following conditions is cancelled.
+   *
+   * Errors of conditions are only reported, if the condition is needed.
+   */
+  std::size_t evalFirst(GCMain &gc, Environment &env,
+      const std::vector<Expr*> &conditions, Value &result) noexcept;
+
+  /*!\brief Waits until done returns true. Evaluates other tasks while
+   * waiting.
+   * \param env Environment with all roots of the calling worker.
+   * \param done Condition checked after notify and after every task.
+   */
+  void waitUntil(Environment &env, const std::function<bool()> &done) noexcept;
+
+  /*!\brief Wakes up workers waiting in waitUntil (after their condition
+   * changed).
+   */
+  void notify() noexcept;
+
+  /*!\brief Queues the evaluation of future (for any worker).
+   */
+  void submit(FutureExpr *future) noexcept;
+
+  /*!\brief Waits for the value of future. Evaluates other tasks while
+   * waiting.
+   * \return Returns the value (converts to false on error).
+   */
+  Value await(GCMain &gc, Environment &env, FutureExpr *future) noexcept;
+
+  /*!\brief The calling worker neither allocates nor evaluates until resume
+   * (e.g. while waiting for input). Collections don't wait for it.
+   * \param env Environment with all roots of the worker.
+   */
+  void suspend(Environment &env) noexcept;
+
+  /*!\brief Continues after suspend (waits for a running collection).
+   */
+  void resume(Environment &env) noexcept;
+
+  /*!\brief Stops for a collection of another worker or collects (if collect
+   * is true).
+   * \param env Innermost environment of the calling worker.
+   * \param collect
+   */
+  void safepoint(Environment &env, bool collect) noexcept;
+};
+
+/*!\brief Collects garbage, if enough objects were allocated.
+ *
+ * Must be called regularly by evaluation loops. Stops the calling thread
+ * if another worker of env.pool collects.
+ */
+void gcSafepoint(GCMain &gc, Environment &env) noexcept;
+
+/*!\return Returns true if the result of the current evaluation isn't needed
+ * anymore or the evaluation was interrupted (evaluation loops should return
+ * nullptr).
+ */
+bool isCancelled() noexcept;
+
+/*!\return Returns true if the current evaluation is speculative (errors
+ * shouldn't be reported).
+ */
+bool isSpeculative() noexcept;
+
+/*!\brief Collects garbage (all roots must be reachable from env or stopped
+ * workers).
+ */
+void collectGarbage(GCMain &gc, Environment &env) noexcept;
+
+#endif /* FUNC_PARALLEL_HPP */
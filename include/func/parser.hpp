@@ -4,6 +4,8 @@
 #include "func/global.hpp"
 #include "func/lexer.hpp"
 #include "func/syntax.hpp"
+#include "func/optimizer.hpp"
+#include "func/builtin.hpp"
 
 /*!\brief Parses primary expression(s). Also parses lambda function
  * substitutions (so also expressions, not only one primary one).
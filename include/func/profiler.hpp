@@ -0,0 +1,92 @@
+#ifndef FUNC_PROFILER_HPP
+#define FUNC_PROFILER_HPP
+
+/*!\file func/profiler.hpp
+ * \brief Costs (reduction steps, time, allocations) of functions.
+ */
+
+#include "func/global.hpp"
+#include "func/syntax.hpp"
+#include "func/trace.hpp"
+
+/*!\brief Collects the costs of function applications by function.
+ *
+ * Functions are named by the applied identifier (named functions and top
+ * level bindings) or by the line of the lambda. Substituted tail calls are
+ * part of the application, which substituted them.
+ */
+class Profiler {
+public:
+  struct Entry {
+    std::size_t calls = 0;
+    std::size_t steps = 0; //!< Reduction steps (inclusive)
+    std::size_t selfSteps = 0; //!< Reduction steps not in other applications
+    std::size_t allocations = 0; //!< Count of allocated objects (inclusive)
+    double time = 0; //!< Milliseconds (inclusive)
+  };
+private:
+  mutable std::mutex mutex; //!< Guards entries
+  std::map<std::string, Entry> entries;
+public:
+  /*!\return Returns the entry of the function name (pointer stays valid).
+   */
+  Entry *getEntry(const std::string &name) noexcept;
+
+  /*!\brief Adds costs to entry.
+   */
+  void add(Entry *entry, const Entry &costs) noexcept;
+
+  /*!\brief Prints the functions sorted by inclusive time.
+   */
+  void print(std::ostream &out) const;
+};
+
+/*!\return Returns the name, which the application expr is profiled as. ""
+ * if expr doesn't apply a function.
+ */
+std::string getApplicationName(const Expr *expr) noexcept;
+
+/*!\brief Profiles and traces the evaluation of an application while alive.
+ *
+ * Does nothing if env.profiler and env.tracer are nullptr or the expression
+ * isn't an application. Inclusive costs of recursive applications are only
+ * counted for the outermost one.
+ */
+class ProfileFrame {
+  bool active = false;
+  Profiler *profiler = nullptr;
+  Profiler::Entry *entry = nullptr;
+  Tracer *tracer = nullptr;
+  std::string name;
+  TokenPos pos; //!< Position of the application (for the trace)
+  ProfileFrame *parent = nullptr; //!< Enclosing frame of the thread
+  bool outermost = false; //!< No other application of entry is running
+  std::chrono::steady_clock::time_point startTime;
+  std::size_t startSteps = 0, startAllocations = 0;
+  std::size_t childSteps = 0; //!< Inclusive steps of the nested frames
+
+  void enter(Environment &env, const Expr *expr) noexcept;
+  void leave() noexcept;
+public:
+  ProfileFrame(Environment &env, const Expr *expr) noexcept
+      : pos(0, 0, 0, 0) {
+    if ((env.profiler || env.tracer) && expr)
+      enter(env, expr);
+  }
+
+  ~ProfileFrame() {
+    if (active)
+      leave();
+  }
+
+  ProfileFrame(const ProfileFrame &) = delete;
+  ProfileFrame &operator =(const ProfileFrame &) = delete;
+};
+
+/*!\brief The next profiled evaluation of expr isn't an own application.
+ *
+ * For the function of a partial application (e.g. add 1 of add 1 2).
+ */
+void ignoreApplication(const Expr *expr) noexcept;
+
+#endif /* FUNC_PROFILER_HPP */
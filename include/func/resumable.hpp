@@ -0,0 +1,94 @@
+#ifndef FUNC_RESUMABLE_HPP
+#define FUNC_RESUMABLE_HPP
+
+/*!\file func/resumable.hpp
+ * \brief Step-wise evaluation (interleave evaluations on one thread).
+ */
+
+#include "func/global.hpp"
+#include "func/syntax.hpp"
+#include "func/sampler.hpp"
+
+#include <ucontext.h>
+
+/*!\brief Evaluation, which is suspended after a count of reduction steps
+ * and resumed later.
+ *
+ * Every evaluation runs on an own stack (stackful coroutine), so the
+ * StackFrameObj roots of a suspended evaluation stay in place. Evaluations
+ * must be resumed by the thread, which created them. They don't use the
+ * thread pool (and must not run while workers evaluate).
+ */
+class Evaluation {
+  GCMain &gc;
+  Environment *env; //!< Environment of the evaluation
+  Expr *expr;
+  Expr *result = nullptr;
+  //! Innermost environment while suspended, result if done (GC root)
+  GCObj *root;
+
+  bool started = false;
+  bool done = false;
+  std::size_t budget = 0; //!< Steps of the current resume call
+  std::size_t resumeSteps = 0; //!< Reduction steps at the resume call
+  std::size_t steps = 0; //!< Reduction steps of all finished resume calls
+
+  EvalContext context;
+  EvalContext *outerContext = nullptr;
+  //! Frames of the shadow stack while suspended (see Sampler)
+  ShadowFrames shadowFrames;
+  Evaluation *outer = nullptr; //!< Evaluation calling resume (nested)
+
+  char *stack;
+  std::size_t stackSize;
+  ucontext_t evalContext, hostContext;
+
+  static void entry() noexcept;
+
+  friend void yieldPoint(Environment &env) noexcept;
+public:
+  //! Default size of the stack (reserved, pages are allocated on use)
+  static const std::size_t defaultStackSize = 8 << 20;
+
+  /*!\brief Prepares the evaluation of expr (nothing is evaluated yet).
+   * \param gc
+   * \param parent Environment to evaluate in. parent.lexer is used for
+   * reporting errors and must live until the evaluation is destroyed.
+   * \param expr
+   * \param stackSize
+   */
+  Evaluation(GCMain &gc, Environment &parent, Expr *expr,
+      std::size_t stackSize = defaultStackSize);
+
+  /*!\brief Releases the stack (a suspended evaluation is abandoned).
+   */
+  ~Evaluation();
+
+  Evaluation(const Evaluation &) = delete;
+  Evaluation &operator =(const Evaluation &) = delete;
+
+  /*!\brief Continues the evaluation for about steps reduction steps.
+   * \return Returns true if the evaluation is finished.
+   */
+  bool resume(std::size_t steps) noexcept;
+
+  //!\return Returns true if the evaluation is finished.
+  bool isDone() const noexcept { return done; }
+
+  /*!\return Returns the evaluated expression, nullptr on error or if not
+   * finished.
+   */
+  Expr *getResult() const noexcept { return result; }
+
+  //!\return Returns count of reduction steps done.
+  std::size_t getSteps() const noexcept { return steps; }
+};
+
+/*!\brief Suspends the current Evaluation, if its steps are used up.
+ *
+ * Must be called regularly by evaluation loops (where all objects in use are
+ * reachable from env like at gcSafepoint).
+ */
+void yieldPoint(Environment &env) noexcept;
+
+#endif /* FUNC_RESUMABLE_HPP */
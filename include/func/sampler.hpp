@@ -0,0 +1,136 @@
+#ifndef FUNC_SAMPLER_HPP
+#define FUNC_SAMPLER_HPP
+
+/*!\file func/sampler.hpp
+ * \brief Sampling profiler (folded stacks of source positions).
+ */
+
+#include "func/global.hpp"
+#include "func/lexer.hpp"
+#include "func/syntax.hpp"
+
+/*!\brief Source position on the shadow stack.
+ */
+struct SamplePos {
+  std::uint32_t line; //!< Index in the lines of the lexer
+  std::uint32_t column;
+};
+
+/*!\brief Samples the shadow stacks (expressions evaluated by ::eval) with a
+ * timer signal (SIGPROF, process CPU time).
+ *
+ * The signal handler only writes to a ring buffer, which is drained into
+ * the folded stacks at garbage collections (drainSamples). Only one sampler
+ * may exist at a time.
+ */
+class Sampler {
+public:
+  //! Frames recorded per sample (outermost first, deeper are cut off)
+  static const std::size_t maxDepth = 64;
+  //! Samples in the ring buffer (more undrained samples are dropped)
+  static const std::size_t capacity = 4096;
+private:
+  struct Sample {
+    std::atomic<bool> ready{false}; //!< Written, but not drained
+    std::size_t depth; //!< Depth of the shadow stack (may exceed maxDepth)
+    SamplePos frames[maxDepth];
+  };
+
+  std::unique_ptr<Sample[]> ring;
+  std::atomic<std::size_t> head{0}; //!< Next sample to write
+  std::atomic<std::size_t> tail{0}; //!< Next sample to drain
+  std::atomic<std::size_t> dropped{0};
+
+  std::mutex drainMutex; //!< Guards tail and stacks
+  //! Count of samples by stack (encoded positions, outermost first)
+  std::map<std::vector<std::uint64_t>, std::size_t> stacks;
+
+  static std::atomic<bool> active; //!< A sampler is running
+public:
+  /*!\brief Starts sampling every interval microseconds of CPU time.
+   */
+  Sampler(long interval = 1000);
+
+  /*!\brief Stops sampling.
+   */
+  ~Sampler();
+
+  Sampler(const Sampler &) = delete;
+  Sampler &operator =(const Sampler &) = delete;
+
+  //!\return Returns true if a sampler is running.
+  static bool isActive() noexcept {
+    return active.load(std::memory_order_relaxed);
+  }
+
+  /*!\brief Records the shadow stack of the calling thread (signal handler).
+   */
+  void record() noexcept;
+
+  /*!\brief Moves the samples of the ring buffer to the folded stacks.
+   */
+  void drain() noexcept;
+
+  /*!\brief Writes the folded stacks ("frame;frame count" per line, input of
+   * flamegraph.pl).
+   * \param out
+   * \param lines Source lines (frames are labeled with their text).
+   */
+  void write(std::ostream &out, const std::vector<std::string> &lines);
+};
+
+/*!\brief Drains the samples of the running sampler (if any).
+ */
+void drainSamples() noexcept;
+
+/*!\brief Pushes pos to the shadow stack of the calling thread.
+ */
+void pushShadowFrame(const TokenPos &pos) noexcept;
+
+/*!\brief Pops the innermost position of the shadow stack.
+ */
+void popShadowFrame() noexcept;
+
+/*!\brief Frames of the shadow stack of a suspended coroutine.
+ * \see Evaluation
+ */
+struct ShadowFrames {
+  std::size_t depth = 0; //!< Count of frames (may exceed frames.size())
+  std::vector<SamplePos> frames; //!< Frames below Sampler::maxDepth
+};
+
+//!\return Returns the depth of the shadow stack of the calling thread.
+std::size_t getShadowDepth() noexcept;
+
+/*!\brief Moves the frames above depth from the shadow stack to frames
+ * (before the host of a coroutine continues).
+ */
+void suspendShadowFrames(std::size_t depth, ShadowFrames &frames) noexcept;
+
+/*!\brief Pushes frames to the shadow stack (before a coroutine continues).
+ *
+ * Frames which were cut off by Sampler::maxDepth are unknown.
+ */
+void resumeShadowFrames(const ShadowFrames &frames) noexcept;
+
+/*!\brief Position of expr on the shadow stack while alive (if sampling).
+ */
+class ShadowFrame {
+  bool pushed;
+public:
+  ShadowFrame(const Expr *expr) noexcept
+      : pushed{expr && Sampler::isActive()} {
+    if (pushed)
+      pushShadowFrame(expr->getTokenPos());
+  }
+
+  ~ShadowFrame() {
+    if (pushed)
+      popShadowFrame();
+  }
+
+  ShadowFrame(const ShadowFrame &) = delete;
+  ShadowFrame &operator =(const ShadowFrame &) = delete;
+};
+
+#endif /* FUNC_SAMPLER_HPP */
@@ -8,6 +8,7 @@
 #include "func/global.hpp"
 #include "func/lexer.hpp"
 #include "func/gc.hpp"
+#include "func/value.hpp"
 
 class Expr;
 class BiOpExpr;
@@ -19,6 +20,15 @@ class AtomExpr;
 class IfExpr;
 class AnyExpr;
 class LetExpr;
+class ThunkExpr;
+class BuiltinExpr;
+class FutureExpr;
+
+struct Builtin;
+class Optimizer;
+class ThreadPool;
+class Profiler;
+class Tracer;
 
 /*!\brief Types of expressions.
  * \see Expr, Expr::getExpressionType
@@ -35,6 +45,90 @@ enum ExprType : int {
   expr_any, //!< Any '_'
   expr_let, //!< Let statement
   expr_fn, //!< Intern statement for named functions
+  expr_thunk, //!< Intern delayed (call-by-need) argument
+  expr_builtin, //!< Builtin function (resolved identifier)
+  expr_future, //!< Result of spawn (value of a concurrent evaluation)
+};
+
+/*!\return Returns the name of type (used by heap dumps and statistics).
+ */
+const char *getExprTypeName(ExprType type) noexcept;
+
+/*!\brief Counters of the evaluator (always counted, see getEvalStats).
+ */
+struct EvalStats {
+  std::size_t reductionSteps = 0; //!< Only set by getEvalStats
+  std::size_t cacheHits = 0; //!< Cached evaluations used by evalWithLookup
+  std::size_t cacheMisses = 0; //!< Evaluations computed by evalWithLookup
+  std::size_t replaceCopies = 0; //!< Nodes created by Expr::replace
+  std::size_t equalsCalls = 0; //!< Outermost Expr::equals calls
+  std::size_t equalsNodes = 0; //!< Nodes compared by Expr::equals
+  std::size_t equalsMaxDepth = 0; //!< Deepest nesting of Expr::equals
+  std::size_t lookups = 0; //!< Environment::get calls
+  std::size_t lookupHops = 0; //!< Environments searched without finding
+  std::size_t framePushes = 0; //!< Expressions added by StackFrameObj
+  std::size_t framePops = 0; //!< Expressions removed by StackFrameObj
+  std::size_t tasksSpawned = 0; //!< Operands offered to other workers
+  std::size_t tasksStolen = 0; //!< Tasks taken from other workers
+  std::size_t allocated[expr_future + 1] = {}; //!< Expressions by ExprType
+
+  //!\brief Adds stats (maximum of equalsMaxDepth).
+  EvalStats &operator +=(const EvalStats &stats) noexcept;
+
+  void print(std::ostream &out) const;
+};
+
+//! Counters of the calling thread (since the last flushEvalStats)
+extern thread_local EvalStats evalStats;
+
+/*!\brief Adds the counters of the calling thread to the total and resets
+ * them.
+ */
+void flushEvalStats() noexcept;
+
+/*!\return Returns the flushed counters plus the counters of the calling
+ * thread.
+ */
+EvalStats getEvalStats() noexcept;
+
+/*!\brief Limits of an evaluation (0 means unlimited).
+ */
+struct EvalLimits {
+  std::size_t maxSteps = 0; //!< Count of reduction steps
+  double timeout = 0; //!< Milliseconds
+};
+
+/*!\brief Remaining budget of an evaluation.
+ *
+ * Shared by all environments of the evaluation (including tasks and futures
+ * spawned by it). Steps are counted by the checking thread. The heap cap of
+ * the collector (GCMain::setMaxObjects) is checked, too.
+ */
+class EvalBudget : public GCObj {
+  GCMain &gc;
+  EvalLimits limits;
+  std::size_t startSteps; //!< getReductionSteps at creation
+  std::chrono::steady_clock::time_point deadline;
+  std::atomic<bool> exceeded{false};
+public:
+  EvalBudget(GCMain &gc, const EvalLimits &limits) noexcept;
+
+  virtual ~EvalBudget() {}
+
+  virtual std::string getTypeName() const noexcept override {
+    return "budget";
+  }
+
+  virtual std::size_t getSize() const noexcept override {
+    return sizeof(EvalBudget);
+  }
+
+  /*!\return Returns false if the budget is used up. The error is reported
+   * once (the first time it isn't speculative).
+   * \param lexer Lexer for reporting the error.
+   * \param pos Position of the expression evaluated.
+   */
+  bool check(Lexer &lexer, const TokenPos &pos) noexcept;
 };
 
 /*!\brief Environment for accessing variables.
@@ -42,12 +136,24 @@ enum ExprType : int {
 class Environment : public GCObj {
   std::map<std::string, Expr*> variables;
   Environment *parent;
+  //! Budget of the evaluation (may be nullptr, replaced between top level
+  //! evaluations while futures may read it)
+  std::atomic<EvalBudget*> budget;
 public:
   Lexer *lexer;
   std::vector<Expr*> ctx; //!< Context to store e.g. stack variables
+  Optimizer *optimizer; //!< Optimizer for top level expressions (may be nullptr)
+  ThreadPool *pool; //!< Pool for parallel evaluation (may be nullptr)
+  Profiler *profiler; //!< Profiler of applications (may be nullptr)
+  Tracer *tracer; //!< Trace of applications (may be nullptr)
 
   Environment(GCMain &gc, Lexer *lexer = nullptr, Environment *parent = nullptr)
-    : GCObj(gc), lexer{lexer}, parent{parent}, variables() {}
+    : GCObj(gc), lexer{lexer}, parent{parent}, variables(),
+      optimizer{parent ? parent->optimizer : nullptr},
+      pool{parent ? parent->pool : nullptr},
+      profiler{parent ? parent->profiler : nullptr},
+      tracer{parent ? parent->tracer : nullptr},
+      budget{parent ? parent->getBudget() : nullptr} {}
   virtual ~Environment() {}
 
   /*!\return Returns name if in environment, nullptr if not.
@@ -63,6 +169,14 @@ public:
    */
   const Expr *currentGet(const std::string &name) const noexcept;
 
+  virtual std::string getTypeName() const noexcept override {
+    return "environment";
+  }
+
+  virtual std::size_t getSize() const noexcept override {
+    return sizeof(Environment);
+  }
+
   virtual void mark(GCMain &gc) noexcept override;
 
   std::map<std::string, Expr*> &getVariables() noexcept
@@ -71,6 +185,19 @@ public:
   /*!\return Returns parent of environment/scope. May be nullptr.
    */
   Environment *getParent() const noexcept { return parent; }
+
+  /*!\return Returns the budget of the evaluation (nullptr if unlimited).
+   */
+  EvalBudget *getBudget() const noexcept {
+    return budget.load(std::memory_order_relaxed);
+  }
+
+  /*!\brief Sets the budget of evaluations in this environment (inherited by
+   * new child environments).
+   */
+  void setBudget(EvalBudget *newBudget) noexcept {
+    budget.store(newBudget, std::memory_order_relaxed);
+  }
 };
 
 std::vector<Expr*>::iterator find(std::vector<Expr*> &vec, Expr *expr) noexcept;
@@ -89,13 +216,17 @@ public:
   StackFrameObj(Environment &env, T *expr = nullptr) noexcept
       : env{env}, expr{expr} {
 
-    if (this->expr) env.ctx.push_back(dynamic_cast<Expr*>(expr));
+    if (this->expr) {
+      env.ctx.push_back(dynamic_cast<Expr*>(expr));
+      ++evalStats.framePushes;
+    }
   }
   
   ~StackFrameObj() {
     if (this->expr) {
       auto it = find(env.ctx, dynamic_cast<Expr*>(this->expr));
       if (it != env.ctx.end()) env.ctx.erase(it);
+      ++evalStats.framePops;
     }
   }
   
@@ -144,11 +275,15 @@ public:
    * \param expr
    */
   StackFrameObj<T>& operator=(T *expr) noexcept {
-    if (expr) env.ctx.push_back(dynamic_cast<Expr*>(expr));
+    if (expr) {
+      env.ctx.push_back(dynamic_cast<Expr*>(expr));
+      ++evalStats.framePushes;
+    }
 
     if (this->expr) {
       auto it = find(env.ctx, dynamic_cast<Expr*>(this->expr));
       if (it != env.ctx.end()) env.ctx.erase(it);
+      ++evalStats.framePops;
     }
   
     this->expr = expr; return *this;
@@ -181,10 +316,19 @@ class Expr : public GCObj {
   ExprType type;
 protected:
   std::size_t depth;
-  Expr *lastEval = nullptr;
+  //! Cached evaluation (published to other threads in parallel mode)
+  std::atomic<Expr*> lastEval{nullptr};
+
+  //!\brief Marks the cached evaluation (if any).
+  void markLastEval(GCMain &gc) noexcept {
+    if (Expr *expr = lastEval.load(std::memory_order_relaxed))
+      expr->mark(gc);
+  }
 public:
   Expr(GCMain &gc, ExprType type, const TokenPos &pos)
-      : GCObj(gc), type{type}, pos(pos) {}
+      : GCObj(gc), type{type}, pos(pos) {
+    ++evalStats.allocated[type];
+  }
 
   virtual ~Expr() {}
 
@@ -197,6 +341,11 @@ public:
    */
   bool hasLastEval() const noexcept { return lastEval != nullptr; }
 
+  //!\brief Forgets the last evaluation (the next one is computed again).
+  void resetLastEval() noexcept {
+    lastEval.store(nullptr, std::memory_order_relaxed);
+  }
+
   /*!\return Returns position of token in code.
    */
   const TokenPos &getTokenPos() const noexcept { return pos; }
@@ -211,6 +360,12 @@ public:
    */
   ExprType getExpressionType() const noexcept { return type; }
 
+  virtual std::string getTypeName() const noexcept override;
+  virtual std::size_t getSize() const noexcept override;
+
+  //!\return Returns the source line of the expression.
+  virtual std::string getSite() const noexcept override;
+
   /*!\brief Evaluates expression one time.
    * \param gc
    * \param env Environment for accessing variables.
@@ -255,6 +410,15 @@ public:
     return std::vector<std::string>();
   }
 
+  /*!\brief Strictness analysis.
+   * \param name Identifier to check.
+   * \return Returns true if evaluating this expression always evaluates the
+   * identifier name (on every path). False if not or if unknown.
+   */
+  virtual bool isStrict(const std::string &name) const noexcept {
+    return false;
+  }
+
   virtual void mark(GCMain &gc) noexcept override;
 
   /*!\return Returns an optimized version of this expression. If nothing was
@@ -306,12 +470,22 @@ public:
       return;
 
     markSelf(gc);
-    if (lastEval) lastEval->mark(gc);
+    markLastEval(gc);
     lhs->mark(gc);
     rhs->mark(gc);
   }
 
   virtual Expr *eval(GCMain &gc, Environment &env) noexcept override;
+
+  /*!\brief Evaluates arithmetic, comparisons, '&&' and '||' completely
+   * without boxing intermediate numbers.
+   * \param gc
+   * \param env
+   * \return Returns the unboxed result. Must not be used for assignments and
+   * lambda substitutions.
+   */
+  Value evalValue(GCMain &gc, Environment &env) noexcept;
+
   virtual Expr *replace(GCMain &gc, const std::string &name, Expr *expr) const noexcept override;
 
   virtual bool equals(const Expr *expr, bool exact = false) const noexcept override;
@@ -337,6 +511,8 @@ public:
     return result;
   }
 
+  virtual bool isStrict(const std::string &name) const noexcept override;
+
   virtual Expr *optimize(GCMain &gc) noexcept override;
 
   /*!\return Returns optimized binary operator expressions.
@@ -361,8 +537,16 @@ public:
   virtual void mark(GCMain &gc) noexcept override;
 
   virtual Expr *eval(GCMain &gc, Environment &env) noexcept override;
+
+  /*!\brief Evaluates the unary operator completely without boxing the
+   * resulting number.
+   */
+  Value evalValue(GCMain &gc, Environment &env) noexcept;
+
   virtual bool equals(const Expr *expr, bool exact = false) const noexcept override;
 
+  virtual bool isStrict(const std::string &name) const noexcept override;
+
   virtual Expr *optimize(GCMain &gc) noexcept override;
   virtual UnOpExpr *optimize(GCMain &gc, std::vector<Expr*> &exprs) noexcept;
 };
@@ -442,6 +626,10 @@ public:
     result.push_back(id);
     return result;
   }
+
+  virtual bool isStrict(const std::string &name) const noexcept override {
+    return name == id;
+  }
 };
 
 /*!\brief Lambda function expression.
@@ -449,6 +637,8 @@ public:
 class LambdaExpr : public Expr {
   std::string name;
   Expr* expr;
+  //! Cached isStrictParameter (-1 unknown)
+  mutable std::atomic<signed char> strict{-1};
 public:
   LambdaExpr(GCMain &gc, const TokenPos &pos, const std::string &name,
              Expr* expr)
@@ -473,7 +663,7 @@ public:
       return;
 
     markSelf(gc);
-    if (lastEval) lastEval->mark(gc);
+    markLastEval(gc);
     expr->mark(gc);
   }
 
@@ -492,6 +682,11 @@ public:
     return result;
   }
 
+  /*!\return Returns true if the body always evaluates the parameter, so the
+   * argument can be evaluated before substitution. Result is cached.
+   */
+  bool isStrictParameter() const noexcept;
+
   virtual Expr *optimize(GCMain &gc) noexcept override;
   virtual LambdaExpr *optimize(GCMain &gc, std::vector<Expr*> &exprs) noexcept;
 };
@@ -523,10 +718,13 @@ public:
  */
 class IfExpr : public Expr {
   Expr *condition, *exprTrue, *exprFalse;
+  bool caseGuard; //!< Condition is the guard of a function case
 public:
-  IfExpr(GCMain &gc, const TokenPos &pos, Expr *condition, Expr *exprTrue, Expr *exprFalse)
+  IfExpr(GCMain &gc, const TokenPos &pos, Expr *condition, Expr *exprTrue,
+      Expr *exprFalse, bool caseGuard = false)
     : Expr(gc, expr_if, TokenPos(pos, exprFalse->getTokenPos())),
-      condition{condition}, exprTrue{exprTrue}, exprFalse{exprFalse} {
+      condition{condition}, exprTrue{exprTrue}, exprFalse{exprFalse},
+      caseGuard{caseGuard} {
     depth = 1 + condition->getDepth()
       + exprTrue->getDepth() + exprFalse->getDepth();
   }
@@ -546,6 +744,22 @@ public:
   //! Evaluated if condition evaluated to the atom .true
   const Expr& getFalse() const noexcept { return *exprFalse; }
 
+  /*!\return Returns true if the if-then-else expression selects a function
+   * case (exprFalse may be the guard of the next case).
+   * \see FunctionExpr::eval
+   */
+  bool isCaseGuard() const noexcept { return caseGuard; }
+
+  /*!\brief Evaluates the guards of this and the following cases in
+   * parallel (env.pool must not be nullptr).
+   * \param gc
+   * \param env
+   * \param result Evaluated expression (nullptr on error).
+   * \return Returns false if the guards weren't worth to be evaluated in
+   * parallel (result isn't set).
+   */
+  bool evalGuards(GCMain &gc, Environment &env, Expr *&result) noexcept;
+
   virtual std::string toString() const noexcept override {
     return "if " + condition->toString() + " then "
       + exprTrue->toString() + " else " + exprFalse->toString();
@@ -557,7 +771,7 @@ public:
       return;
 
     markSelf(gc);
-    if (lastEval) lastEval->mark(gc);
+    markLastEval(gc);
     condition->mark(gc);
     exprTrue->mark(gc);
     exprFalse->mark(gc);
@@ -578,6 +792,8 @@ public:
     return result;
   }
 
+  virtual bool isStrict(const std::string &name) const noexcept override;
+
   virtual Expr *optimize(GCMain &gc) noexcept override;
   virtual Expr *optimize(GCMain &gc, std::vector<Expr*> &exprs) noexcept;
 };
@@ -635,7 +851,7 @@ public:
       return;
 
     markSelf(gc);
-    if(lastEval) lastEval->mark(gc);
+    markLastEval(gc);
     for (BiOpExpr *expr : assignments)
       expr->mark(gc);
 
@@ -656,6 +872,8 @@ public:
 
   virtual bool equals(const Expr *expr, bool exact = false) const noexcept override;
 
+  virtual bool isStrict(const std::string &name) const noexcept override;
+
   virtual std::string toString() const noexcept override {
     std::string result = "let ";
     auto &asgs = const_cast<std::vector<BiOpExpr*>&>(assignments);
@@ -676,8 +894,20 @@ public:
 /*!\brief Represents a named function.
  */
 class FunctionExpr : public Expr {
+public:
+  /*!\brief Residual body of an application with constant arguments.
+   * \see Optimizer
+   */
+  struct Specialization {
+    //! Parameter for every non-constant argument ("" if not used)
+    std::vector<std::string> params;
+    Expr *body; //!< Body of the selected case, nullptr if none selectable
+  };
+private:
   std::string name;
   std::vector<std::pair<std::vector<Expr*>, Expr*>>  fncases;
+  //! Specializations by constant arguments (invalidated by addCase)
+  std::map<std::string, Specialization> specializations;
 public:
   FunctionExpr(GCMain &gc, const TokenPos &pos,
       const std::string &name,
@@ -704,6 +934,19 @@ public:
   const std::vector<std::pair<std::vector<Expr*>, Expr*>> &getFunctionCases()
     const noexcept { return fncases; }
 
+  /*!\return Returns cached specialization for key, nullptr if there is none.
+   * \param key Constant arguments of the application.
+   */
+  const Specialization *getSpecialization(const std::string &key) const noexcept;
+
+  /*!\brief Caches spec for key.
+   */
+  void addSpecialization(const std::string &key, Specialization spec) noexcept;
+
+  //!\return Returns the cached specializations (by constant arguments).
+  const std::map<std::string, Specialization> &getSpecializations()
+    const noexcept { return specializations; }
+
   virtual void mark(GCMain &gc) noexcept override;
 
   virtual Expr *eval(GCMain &gc, Environment &env) noexcept;
@@ -713,9 +956,128 @@ public:
   }
 };
 
+/*!\brief Delayed argument of a lambda substitution (call-by-need).
+ *
+ * The argument is evaluated at most once. After evaluation the thunk is
+ * overwritten with its value, so every substituted occurrence shares the
+ * result.
+ */
+class ThunkExpr : public Expr {
+  std::atomic<Expr*> expr;
+  std::atomic<bool> evaluated{false}; //!< True if expr is already the value
+  //! Context of the evaluation forcing the thunk (detects self-forcing)
+  std::atomic<const void*> evaluator{nullptr};
+  //! Thread of evaluator (default id if evaluator may be suspended)
+  std::atomic<std::thread::id> evaluatorThread{};
+  //! Another thread waits until evaluator is done
+  std::atomic<bool> waiting{false};
+public:
+  ThunkExpr(GCMain &gc, Expr *expr)
+      : Expr(gc, expr_thunk, expr->getTokenPos()), expr{expr} {
+    depth = 1 + expr->getDepth();
+  }
+
+  virtual ~ThunkExpr() {}
+
+  /*!\return Returns true, if the thunk has already been evaluated.
+   */
+  bool isEvaluated() const noexcept {
+    return evaluated.load(std::memory_order_acquire);
+  }
+
+  /*!\return Returns the value if evaluated, otherwise the delayed expression.
+   */
+  const Expr &getExpression() const noexcept {
+    return *expr.load(std::memory_order_acquire);
+  }
+
+  /*!\return Returns true if expr is a value, which doesn't need to be delayed
+   * (numbers, atoms, lambdas, identifiers, ...).
+   */
+  static bool isValue(const Expr *expr) noexcept;
+
+  virtual std::string toString() const noexcept override {
+    return getExpression().toString();
+  }
+
+  //!\brief Mark self and expr.
+  virtual void mark(GCMain &gc) noexcept override {
+    if (isMarked(gc))
+      return;
+
+    markSelf(gc);
+    markLastEval(gc);
+    expr.load(std::memory_order_relaxed)->mark(gc);
+  }
+
+  virtual Expr *eval(GCMain &gc, Environment &env) noexcept override;
+  virtual Expr *replace(GCMain &gc, const std::string &name, Expr *expr) const noexcept override;
+
+  virtual bool equals(const Expr *expr, bool exact = false) const noexcept override;
+
+  virtual std::vector<std::string> getIdentifiers() const noexcept override {
+    return getExpression().getIdentifiers();
+  }
+};
+
+/*!\brief Builtin function. Identifiers of builtins are resolved while
+ * parsing (if not bound otherwise), so applications don't need to look them
+ * up by name.
+ * \see Builtin, resolveBuiltins
+ */
+class BuiltinExpr : public Expr {
+  const Builtin *builtin;
+  std::vector<Value> args; //!< Evaluated arguments of partial applications
+public:
+  BuiltinExpr(GCMain &gc, const TokenPos &pos, const Builtin *builtin,
+      std::vector<Value> args = std::vector<Value>())
+      : Expr(gc, expr_builtin, pos), builtin{builtin}, args(std::move(args)) {
+    depth = 1;
+  }
+
+  virtual ~BuiltinExpr() {}
+
+  const Builtin &getBuiltin() const noexcept { return *builtin; }
+
+  //!\return Returns evaluated arguments already applied.
+  const std::vector<Value> &getArguments() const noexcept { return args; }
+
+  /*!\return Returns builtin applied to arg, nullptr on error.
+   * \param gc
+   * \param env
+   * \param pos Position of the application.
+   * \param arg Argument (not evaluated).
+   */
+  Expr *apply(GCMain &gc, Environment &env, const TokenPos &pos, Expr *arg) noexcept;
+
+  virtual std::string toString() const noexcept override;
+
+  //!\brief Mark self and arguments.
+  virtual void mark(GCMain &gc) noexcept override;
+
+  virtual bool equals(const Expr *expr, bool exact = false) const noexcept override;
+};
+
 Expr *reportSyntaxError(Lexer &lexer, const std::string &msg,
     const TokenPos &pos);
 
+/*!\brief State of an evaluation, which isn't shared with other evaluations
+ * running on the same thread.
+ * \see Evaluation
+ */
+struct EvalContext {
+  //! Thunks forced, while another evaluation forces them, too
+  std::vector<const ThunkExpr*> sharedThunks;
+  //! Thread of the evaluation (default id for coroutines, which may be
+  //! suspended while forcing a thunk)
+  std::thread::id thread;
+};
+
+/*!\return Returns the context of the current evaluation (of the calling
+ * thread).
+ */
+EvalContext *&currentEvalContext() noexcept;
+
 /*!\brief Executes eval function for given expr as long as different expr
  * is returned.
  * \param gc
@@ -724,6 +1086,15 @@ Expr *reportSyntaxError(Lexer &lexer, const std::string &msg,
  */
 Expr *eval(GCMain &gc, Environment &env, Expr *expr) noexcept;
 
+/*!\brief Evaluates expr completely like eval, but arithmetic and
+ * comparisons are evaluated without boxing intermediate results.
+ * \param gc
+ * \param env Environment to use
+ * \param expr Expression to evaluate
+ * \return Returns the unboxed value (converts to false on error).
+ */
+Value evalValue(GCMain &gc, Environment &env, Expr *expr) noexcept;
+
 /*!\brief Executes eval function for given expressions as long as differenct
  * expr returned. Breadth first execution.
  * \param gc
@@ -734,4 +1105,48 @@ Expr *eval(GCMain &gc, Environment &env, Expr *expr) noexcept;
 void breadthEval(GCMain &gc, Environment &env,
     StackFrameObj<Expr> &lhs, StackFrameObj<Expr> &rhs) noexcept;
 
+/*!\return Returns count of reduction steps (Expr::evalWithLookup calls,
+ * except forcing thunks) since program start.
+ *
+ * Steps of other threads are only included after they called
+ * flushReductionSteps.
+ */
+std::size_t getReductionSteps() noexcept;
+
+/*!\brief Adds the reduction steps of the calling thread to the total.
+ */
+void flushReductionSteps() noexcept;
+
+/*!\return Returns count of reduction steps of the calling thread (flushed
+ * or not).
+ */
+std::size_t getThreadReductionSteps() noexcept;
+
+/*!\brief Counts the application of a builtin with side effects. Evaluations
+ * during which one was applied aren't cached (Expr::evalWithLookup).
+ */
+void countEffect() noexcept;
+
+/*!\brief Interrupts the running top level evaluations. Async-signal-safe
+ * (e.g. for a SIGINT handler).
+ * \return Returns false if no evaluation is running (nothing interrupted).
+ * \see beginInterruptible
+ */
+bool interruptEvaluation() noexcept;
+
+/*!\return Returns true if the running evaluations were interrupted
+ * (evaluation loops return nullptr, errors aren't reported).
+ */
+bool isInterrupted() noexcept;
+
+/*!\brief Marks the start of a top level evaluation (may be interrupted).
+ */
+void beginInterruptible() noexcept;
+
+/*!\brief Marks the end of a top level evaluation.
+ * \return Returns true if it was interrupted. The interrupt is reset after
+ * the last running evaluation ended.
+ */
+bool endInterruptible() noexcept;
+
 #endif /* FUNC_SYNTAX_HPP */
@@ -0,0 +1,54 @@
+#ifndef FUNC_TRACE_HPP
+#define FUNC_TRACE_HPP
+
+/*!\file func/trace.hpp
+ * \brief Trace of evaluation and GC phases (Chrome trace event format).
+ */
+
+#include "func/global.hpp"
+#include "func/lexer.hpp"
+
+/*!\brief Writes spans as JSON trace events (chrome://tracing, Perfetto).
+ *
+ * Events are written while tracing, the file is complete after the tracer
+ * was destroyed. Threads are numbered in order of their first span.
+ */
+class Tracer {
+public:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+private:
+  std::mutex mutex; //!< Guards out and first
+  std::ofstream out;
+  bool first = true; //!< No event written yet
+  TimePoint start;
+public:
+  /*!\brief Opens filename for writing.
+   * \see isOpen
+   */
+  Tracer(const std::string &filename);
+
+  /*!\brief Completes the file.
+   */
+  ~Tracer();
+
+  Tracer(const Tracer &) = delete;
+  Tracer &operator =(const Tracer &) = delete;
+
+  //!\return Returns true if the file was opened.
+  bool isOpen() const noexcept { return out.is_open(); }
+
+  /*!\brief Writes span (complete event) of the calling thread.
+   * \param name
+   * \param category e.g. "eval", "gc", "parse"
+   * \param begin
+   * \param end
+   * \param pos Source position of the span (may be nullptr).
+   */
+  void span(const std::string &name, const char *category,
+      TimePoint begin, TimePoint end, const TokenPos *pos = nullptr) noexcept;
+
+  //!\return Returns the current time.
+  static TimePoint now() noexcept { return std::chrono::steady_clock::now(); }
+};
+
+#endif /* FUNC_TRACE_HPP */
@@ -0,0 +1,58 @@
+#ifndef FUNC_TYPECHECK_HPP
+#define FUNC_TYPECHECK_HPP
+
+/*!\file func/typecheck.hpp
+ * \brief Static type inference of top level expressions.
+ */
+
+#include "func/global.hpp"
+#include "func/syntax.hpp"
+#include "func/optimizer.hpp"
+
+/*!\brief Types which can be inferred.
+ */
+enum TypeKind : unsigned char {
+  type_var, //!< Not known yet (unification variable)
+  type_dyn, //!< Not inferable statically, compatible with everything
+  type_int, //!< Integer number
+  type_num, //!< Floating-point number
+  type_atom, //!< Atom (also atom constructors and booleans)
+  type_fn, //!< Lambda function (param -> result)
+};
+
+/*!\brief Inferred type.
+ */
+struct Type {
+  TypeKind kind;
+  Type *link; //!< Type bound to type_var, nullptr if unbound
+  Type *param, *result; //!< Parameter and result of type_fn
+
+  Type(TypeKind kind, Type *param = nullptr, Type *result = nullptr)
+    : kind{kind}, link{nullptr}, param{param}, result{result} {}
+};
+
+/*!\return Returns readable type (e.g. "int -> int").
+ */
+std::string toString(const Type *type) noexcept;
+
+/*!\brief Hindley-Milner style type inference over ints, nums, atoms and
+ * lambda functions.
+ *
+ * Type errors (e.g. int + num, arguments of wrong type, arity mismatches of
+ * named function cases) are reported before evaluation. Types don't change
+ * the evaluation: values of type_dyn may reach every operator, so the
+ * evaluator checks the operands anyway.
+ *
+ * Identifiers without a definition (builtins, functions defined later),
+ * fields of atom constructors and disagreeing branches are of type_dyn,
+ * which never causes type errors.
+ */
+class TypeInferencePass : public OptimizerPass {
+protected:
+  virtual Expr *apply(GCMain &gc, Environment &env, Expr *expr) noexcept override;
+public:
+  virtual const char *getName() const noexcept override
+    { return "type-inference"; }
+};
+
+#endif /* FUNC_TYPECHECK_HPP */
@@ -0,0 +1,91 @@
+#ifndef FUNC_VALUE_HPP
+#define FUNC_VALUE_HPP
+
+/*!\file func/value.hpp
+ * \brief Unboxed values of evaluations.
+ */
+
+#include "func/global.hpp"
+#include "func/lexer.hpp"
+#include "func/gc.hpp"
+
+class Expr;
+
+/*!\brief Types of values.
+ * \see Value, Value::getValueType
+ */
+enum ValueType : unsigned char {
+  val_expr, //!< Boxed expression (nullptr on error)
+  val_int, //!< Integer number (immediate)
+  val_num, //!< Floating-point number (immediate)
+  val_bool, //!< Atom .true or .false (immediate)
+};
+
+/*!\brief Result of an evaluation.
+ *
+ * Integer numbers, floating-point numbers and the result of comparisons are
+ * carried as tagged immediates, so evaluating arithmetic doesn't allocate
+ * an expression for every intermediate result. Everything else is carried
+ * as expression. Use toExpr to materialize the value as expression.
+ */
+class Value {
+  ValueType type;
+  union {
+    std::int64_t integer;
+    double number;
+    bool boolean;
+    Expr *expr;
+  };
+
+  Value(ValueType type) noexcept : type{type} {}
+public:
+  //!\brief Initialize as boxed expression (nullptr is an error).
+  Value(Expr *expr = nullptr) noexcept : type{val_expr}, expr{expr} {}
+
+  static Value fromInt(std::int64_t num) noexcept
+    { Value result(val_int); result.integer = num; return result; }
+  static Value fromNum(double num) noexcept
+    { Value result(val_num); result.number = num; return result; }
+  static Value fromBool(bool b) noexcept
+    { Value result(val_bool); result.boolean = b; return result; }
+
+  /*!\return Returns the value of expr. Integer and floating-point numbers
+   * and the atoms .true and .false are unboxed.
+   */
+  static Value unbox(Expr *expr) noexcept;
+
+  //!\return Returns the type of the value.
+  ValueType getValueType() const noexcept { return type; }
+
+  bool isInt() const noexcept { return type == val_int; }
+  bool isNum() const noexcept { return type == val_num; }
+  bool isBool() const noexcept { return type == val_bool; }
+  bool isExpr() const noexcept { return type == val_expr; }
+
+  std::int64_t getInt() const noexcept { return integer; }
+  double getNum() const noexcept { return number; }
+  bool getBool() const noexcept { return boolean; }
+  //!\return Returns boxed expression (nullptr if not val_expr).
+  Expr *getExpr() const noexcept { return type == val_expr ? expr : nullptr; }
+
+  /*!\return Returns true if value is an atom (val_bool or AtomExpr).
+   */
+  bool isAtom() const noexcept;
+
+  /*!\return Returns false if value is the atom .false, otherwise true.
+   */
+  bool isTrue() const noexcept;
+
+  /*!\return Returns the value as expression. Allocates a new expression
+   * if the value is an immediate.
+   * \param gc
+   * \param pos Position of a new expression.
+   */
+  Expr *toExpr(GCMain &gc, const TokenPos &pos) const noexcept;
+
+  //!\return Returns true, if the value is not an error.
+  explicit operator bool() const noexcept
+    { return type != val_expr || expr != nullptr; }
+};
+
+#endif /* FUNC_VALUE_HPP */
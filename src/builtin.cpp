@@ -0,0 +1,351 @@
+#include "func/builtin.hpp"
+#include "func/optimizer.hpp"
+#include "func/parallel.hpp"
+
+// Builtin functions
+
+static Expr *builtinError(GCMain &gc, Environment &env,
+    const TokenPos &pos, const std::vector<Value> &args, Expr *arg) {
+  // print error message
+  return reportSyntaxError(*env.lexer, arg->toString(), pos);
+}
+
+static Expr *builtinPrint(GCMain &gc, Environment &env,
+    const TokenPos &pos, const std::vector<Value> &args, Expr *arg) {
+  // print expression and return expr
+  std::cout << arg->toString() << std::endl;
+  return arg;
+}
+
+static Value nativeToInt(GCMain &gc, Environment &env,
+    const TokenPos &pos, const std::vector<Value> &args) {
+  // truncate float to int
+  if (args[0].isNum())
+    return Value::fromInt((int64_t) floor(args[0].getNum()));
+  if (args[0].isInt())
+    return args[0];
+
+  return Value(reportSyntaxError(*env.lexer, "to_int expects a number.", pos));
+}
+
+static Value nativeRoundInt(GCMain &gc, Environment &env,
+    const TokenPos &pos, const std::vector<Value> &args) {
+  if (args[0].isNum())
+    return Value::fromInt((int64_t) round(args[0].getNum()));
+  if (args[0].isInt())
+    return args[0];
+
+  return Value(reportSyntaxError(*env.lexer, "round_int expects a number.", pos));
+}
+
+static Expr *builtinTime(GCMain &gc, Environment &env,
+    const TokenPos &pos, const std::vector<Value> &args, Expr *arg) {
+  // prints time spent evaluating RHS
+  auto startTime = std::chrono::high_resolution_clock::now();
+
+  StackFrameObj<Expr> expr(env, ::eval(gc, env, arg));
+  if (!expr) return nullptr;
+
+  auto endTime = std::chrono::high_resolution_clock::now();
+  auto diffTime = endTime - startTime;
+  double consumedTime = diffTime.count() *
+    (double)std::chrono::high_resolution_clock::period::num /
+    (double)std::chrono::high_resolution_clock::period::den
+    * 1000; // seconds -> milliseconds
+
+  std::cout << "Needed "
+    << consumedTime
+    << " ms." << std::endl;
+
+  return *expr;
+}
+
+/*!\brief Forgets the last evaluations of expr and everything reachable
+ * from it (see Expr::resetLastEval): children, the functions its identifiers
+ * refer to (with their cases and specializations) and delayed arguments.
+ * \param visited Already reset expressions.
+ */
+static void resetEvaluations(Environment &env, const Expr *expr,
+    std::set<const Expr*> &visited) noexcept {
+  if (!expr || !visited.insert(expr).second)
+    return;
+
+  const_cast<Expr*>(expr)->resetLastEval();
+
+  switch (expr->getExpressionType()) {
+  case expr_biop: {
+      const BiOpExpr *biop = dynamic_cast<const BiOpExpr*>(expr);
+      resetEvaluations(env, &biop->getLHS(), visited);
+      resetEvaluations(env, &biop->getRHS(), visited);
+      break;
+    }
+  case expr_unop:
+    resetEvaluations(env,
+        &dynamic_cast<const UnOpExpr*>(expr)->getExpression(), visited);
+    break;
+  case expr_id:
+    // Local identifiers may resolve to a global one (resetting too much)
+    resetEvaluations(env,
+        env.get(dynamic_cast<const IdExpr*>(expr)->getName()), visited);
+    break;
+  case expr_lambda:
+    resetEvaluations(env,
+        &dynamic_cast<const LambdaExpr*>(expr)->getExpression(), visited);
+    break;
+  case expr_if: {
+      const IfExpr *ifexpr = dynamic_cast<const IfExpr*>(expr);
+      resetEvaluations(env, &ifexpr->getCondition(), visited);
+      resetEvaluations(env, &ifexpr->getTrue(), visited);
+      resetEvaluations(env, &ifexpr->getFalse(), visited);
+      break;
+    }
+  case expr_let: {
+      const LetExpr *letexpr = dynamic_cast<const LetExpr*>(expr);
+      for (const BiOpExpr *asg : letexpr->getAssignments())
+        resetEvaluations(env, asg, visited);
+      resetEvaluations(env, &letexpr->getBody(), visited);
+      break;
+    }
+  case expr_fn: {
+      const FunctionExpr *fnexpr = dynamic_cast<const FunctionExpr*>(expr);
+      for (auto &fncase : fnexpr->getFunctionCases()) {
+        for (const Expr *pattern : fncase.first)
+          resetEvaluations(env, pattern, visited);
+        resetEvaluations(env, fncase.second, visited);
+      }
+      for (auto &p : fnexpr->getSpecializations())
+        resetEvaluations(env, p.second.body, visited);
+      break;
+    }
+  case expr_thunk:
+    // A forced thunk keeps its value (call-by-need), but not the caches in it
+    resetEvaluations(env,
+        &dynamic_cast<const ThunkExpr*>(expr)->getExpression(), visited);
+    break;
+  case expr_builtin:
+    for (const Value &value
+        : dynamic_cast<const BuiltinExpr*>(expr)->getArguments())
+      resetEvaluations(env, value.getExpr(), visited);
+    break;
+  }
+}
+
+static Expr *builtinBenchmark(GCMain &gc, Environment &env,
+    const TokenPos &pos, const std::vector<Value> &args, Expr *arg) {
+  // evaluates arg once for warming up and then runs times
+  if (!args[0].isInt() || args[0].getInt() < 1)
+    return reportSyntaxError(*env.lexer,
+        "benchmark expects a positive count of runs.", pos);
+
+  std::size_t runs = args[0].getInt();
+  StackFrameObj<Expr> exprObj(env, arg);
+  StackFrameObj<Expr> result(env, ::eval(gc, env, arg));
+  if (!result) return nullptr;
+
+  std::vector<double> times;
+  // Counters of all workers (flushed after every task)
+  std::size_t steps = getReductionSteps();
+  std::size_t allocated = GCMain::getTotalAllocated();
+  std::size_t collections = gc.getCountCollections();
+  double collectTime = gc.getCollectTime();
+  for (std::size_t i = 0; i < runs; ++i) {
+    std::set<const Expr*> visited;
+    resetEvaluations(env, arg, visited); // no cached results of earlier runs
+
+    auto startTime = std::chrono::steady_clock::now();
+    result = ::eval(gc, env, arg);
+    if (!result) return nullptr;
+
+    times.push_back(std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - startTime).count());
+  }
+
+  steps = getReductionSteps() - steps;
+  allocated = GCMain::getTotalAllocated() - allocated;
+  collections = gc.getCountCollections() - collections;
+  collectTime = gc.getCollectTime() - collectTime;
+
+  std::sort(times.begin(), times.end());
+  std::size_t p99 = (runs * 99 + 99) / 100 - 1;
+  std::cout << "Benchmark of " << runs << " runs:" << std::endl
+    << "  time: min " << times.front() << " ms, median "
+      << times[runs / 2] << " ms, p99 " << times[p99] << " ms" << std::endl
+    << "  per run: " << steps / runs << " steps, " << allocated / runs
+      << " allocations, " << collectTime / runs << " ms in "
+      << double(collections) / runs << " collections" << std::endl;
+
+  return *result;
+}
+
+static Expr *builtinSpawn(GCMain &gc, Environment &env,
+    const TokenPos &pos, const std::vector<Value> &args, Expr *arg) {
+  // evaluate arg concurrently
+  FutureExpr *future = new FutureExpr(gc, pos, arg, env);
+  if (env.pool)
+    env.pool->submit(future);
+  else
+    future->evaluate(gc);
+
+  return future;
+}
+
+static Expr *builtinAwait(GCMain &gc, Environment &env,
+    const TokenPos &pos, const std::vector<Value> &args, Expr *arg) {
+  // wait for the value of a future
+  StackFrameObj<Expr> expr(env, ::eval(gc, env, arg));
+  if (!expr) return nullptr;
+
+  if (expr->getExpressionType() != expr_future)
+    return reportSyntaxError(*env.lexer, "await expects a future.", pos);
+
+  FutureExpr *future = dynamic_cast<FutureExpr*>(*expr);
+  Value value = env.pool ? env.pool->await(gc, env, future)
+    : future->getValue();
+  if (!value) return nullptr; // error forwarding (reported by the future)
+
+  return value.toExpr(gc, pos);
+}
+
+static Expr *builtinHeapDump(GCMain &gc, Environment &env,
+    const TokenPos &pos, const std::vector<Value> &args, Expr *arg) {
+  // histogram of the live objects at the next collection
+  StackFrameObj<Expr> expr(env, ::eval(gc, env, arg));
+  if (!expr) return nullptr;
+
+  const AtomExpr *atom = expr->getExpressionType() == expr_atom
+    ? dynamic_cast<const AtomExpr*>(*expr) : nullptr;
+  if (!atom || (atom->getName() != "types" && atom->getName() != "sites"))
+    return reportSyntaxError(*env.lexer,
+        "heap_dump expects .types or .sites.", pos);
+
+  gc.requestHeapDump(atom->getName() == "sites");
+  return *expr;
+}
+
+// Builtin table
+
+static std::map<std::string, Builtin> &getBuiltins() noexcept {
+  static std::map<std::string, Builtin> builtins{
+    {"error", Builtin{"error", builtinError, 1, nullptr}},
+    {"print", Builtin{"print", builtinPrint, 1, nullptr, true}},
+    {"to_int", Builtin{"to_int", nullptr, 1, nativeToInt}},
+    {"round_int", Builtin{"round_int", nullptr, 1, nativeRoundInt}},
+    {"time", Builtin{"time", builtinTime, 1, nullptr, true}},
+    {"benchmark", Builtin{"benchmark", builtinBenchmark, 2, nullptr, true}},
+    {"spawn", Builtin{"spawn", builtinSpawn, 1, nullptr}},
+    {"await", Builtin{"await", builtinAwait, 1, nullptr}},
+    {"heap_dump", Builtin{"heap_dump", builtinHeapDump, 1, nullptr, true}},
+  };
+
+  return builtins;
+}
+
+const Builtin *findBuiltin(const std::string &name) noexcept {
+  auto &builtins = getBuiltins();
+  auto it = builtins.find(name);
+  if (it == builtins.end())
+    return nullptr;
+
+  return &it->second;
+}
+
+void addBuiltin(const std::string &name, BuiltinFn fn) noexcept {
+  getBuiltins()[name] = Builtin{name, fn, 1, nullptr, true};
+}
+
+bool registerNative(const std::string &name, std::size_t arity,
+    NativeFn native) noexcept {
+  if (arity == 0 || !native)
+    return false;
+
+  getBuiltins()[name] = Builtin{name, nullptr, arity, std::move(native)};
+  return true;
+}
+
+// BuiltinExpr
+
+Expr *BuiltinExpr::apply(GCMain &gc, Environment &env,
+    const TokenPos &pos, Expr *arg) noexcept {
+  StackFrameObj<Expr> thisObj(env, this);
+
+  if (builtin->fn && args.size() + 1 >= builtin->arity) {
+    if (builtin->effects && isSpeculative())
+      return nullptr; // applied again, if the result is needed
+    if (builtin->effects)
+      countEffect();
+
+    return builtin->fn(gc, env, pos, args, arg);
+  }
+
+  // Native or leading argument of fn: evaluate argument
+  Value value = ::evalValue(gc, env, arg);
+  if (!value) return nullptr; // error forwarding
+  StackFrameObj<Expr> valueObj(env, value.getExpr());
+
+  std::vector<Value> newargs(args);
+  newargs.push_back(value);
+  if (newargs.size() < builtin->arity || builtin->fn) // partial application
+    return new BuiltinExpr(gc, pos, builtin, std::move(newargs));
+
+  Value result = builtin->native(gc, env, pos, newargs);
+  if (!result) return nullptr; // error forwarding
+
+  return result.toExpr(gc, pos);
+}
+
+static std::string toString(const Value &value) noexcept {
+  switch (value.getValueType()) {
+  case val_int: return std::to_string(value.getInt());
+  case val_num: return std::to_string(value.getNum());
+  case val_bool: return value.getBool() ? ".true" : ".false";
+  }
+
+  return value.getExpr()->toString();
+}
+
+std::string BuiltinExpr::toString() const noexcept {
+  std::string result = builtin->name;
+  for (const Value &arg : args)
+    result += " " + ::toString(arg);
+
+  return result;
+}
+
+void BuiltinExpr::mark(GCMain &gc) noexcept {
+  if (isMarked(gc))
+    return;
+
+  markSelf(gc);
+  markLastEval(gc);
+
+  for (const Value &arg : args)
+    if (arg.getExpr()) arg.getExpr()->mark(gc);
+}
+
+// Resolution
+
+/*!\brief Replaces unbound identifiers of builtins with BuiltinExpr.
+ */
+class BuiltinResolution : public OptimizerPass {
+protected:
+  virtual Expr *rewrite(GCMain &gc, Environment &env, Expr *expr,
+      const Scope &scope) noexcept override {
+    if (expr->getExpressionType() != expr_id)
+      return expr;
+
+    const std::string &name = dynamic_cast<IdExpr*>(expr)->getName();
+    const Builtin *builtin = findBuiltin(name);
+    if (!builtin || isBound(scope, name) || env.get(name))
+      return expr;
+
+    return new BuiltinExpr(gc, expr->getTokenPos(), builtin);
+  }
+public:
+  virtual const char *getName() const noexcept override
+    { return "builtin-resolution"; }
+};
+
+Expr *resolveBuiltins(GCMain &gc, Environment &env, Expr *expr) noexcept {
+  BuiltinResolution resolution;
+  return resolution.run(gc, env, expr);
+}
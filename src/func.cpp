@@ -1,12 +1,13 @@
 #include "func/func.hpp"
 
-bool interpret(std::istream &input, GCMain &gc,
-    std::vector<std::string> &lines,
+/*!\brief Interprets the tokens of lexer (see interpret).
+ */
+static bool interpretTokens(Lexer &lexer, GCMain &gc,
     Environment *env,
-    bool interpret_mode) noexcept {
+    bool interpret_mode,
+    const EvalLimits &limits) noexcept {
   bool error = false;
 
-  Lexer lexer(input, lines);
   if (interpret_mode)
     lexer.skippedNewLinePrefix = "..";
 
@@ -19,8 +20,16 @@ bool interpret(std::istream &input, GCMain &gc,
   while (true) {
     if (interpret_mode)
       std::cout << "> "; // print prefix
+
+    // Futures may be evaluated (and collect garbage) while waiting for input
+    if (env->pool) env->pool->suspend(*env);
   	lexer.nextToken(); // aquire next token (if first loop, first token)
+    if (env->pool) env->pool->resume(*env);
+    Tracer::TimePoint parseStart = Tracer::now();
 	  expr = parse(gc, lexer, *env);
+    if (env->tracer && expr)
+      env->tracer->span("parse", "parse", parseStart, Tracer::now(),
+          &expr->getTokenPos());
 
     // Just jump if emtpy (error recovery and new-line support)
     if (!expr) { // empty
@@ -38,8 +47,22 @@ bool interpret(std::istream &input, GCMain &gc,
     bool shouldPrint = expr->getExpressionType() != expr_biop
       || ((BiOpExpr*) expr)->getOperator() != op_asg;
 
+    // Every top level expression has an own budget
+    EvalBudget *outerBudget = env->getBudget();
+    if (limits.maxSteps > 0 || limits.timeout > 0 || gc.getMaxObjects() > 0)
+      env->setBudget(new EvalBudget(gc, limits));
+
     // Evaluate as long as expression is different from the evaluated one
+    TokenPos pos = expr->getTokenPos();
+    std::string traceName = env->tracer ? expr->toString().substr(0, 60) : "";
+    Tracer::TimePoint evalStart = Tracer::now();
+    beginInterruptible();
     expr = eval(gc, *env, expr);
+    env->setBudget(outerBudget);
+    if (env->tracer)
+      env->tracer->span(traceName, "toplevel", evalStart, Tracer::now(), &pos);
+    if (endInterruptible() && !expr)
+      reportSyntaxError(lexer, "Evaluation interrupted.", pos);
 
     // Print the expression
     if (expr && shouldPrint) {
@@ -50,9 +73,25 @@ bool interpret(std::istream &input, GCMain &gc,
     if (lexer.currentToken() == tok_eof)
       break;
 
-    env->mark(gc); // mark main scope/environemnt
-    gc.collect();
+    collectGarbage(gc, *env); // mark main scope/environemnt
   }
 
   return !error;
 }
+
+bool interpret(std::istream &input, GCMain &gc,
+    std::vector<std::string> &lines,
+    Environment *env,
+    bool interpret_mode,
+    const EvalLimits &limits) noexcept {
+  Lexer lexer(input, lines);
+  return interpretTokens(lexer, gc, env, interpret_mode, limits);
+}
+
+bool interpret(const MappedFile &file, GCMain &gc,
+    std::vector<std::string> &lines,
+    Environment *env,
+    const EvalLimits &limits) noexcept {
+  Lexer lexer(file.begin(), file.end(), lines);
+  return interpretTokens(lexer, gc, env, false, limits);
+}
@@ -1,4 +1,5 @@
 #include "func/gc.hpp"
+#include "func/trace.hpp"
 
 GCObj::GCObj(GCMain &main) noexcept : marked(!main.getMarkBit()) {
   main.add(this);
@@ -20,43 +21,232 @@ void GCObj::mark(GCMain &main) noexcept {
 }
 // GCMain
 
+//! Allocation buffer of the current thread (nullptr if not attached)
+static thread_local GCThreadBuffer *currentBuffer = nullptr;
+//! Count of objects allocated by the current thread
+static thread_local std::size_t countAllocated = 0;
+//! Part of countAllocated added to totalAllocated
+static thread_local std::size_t flushedAllocated = 0;
+//! Flushed allocations of all threads
+static std::atomic<std::size_t> totalAllocated{0};
+
 GCMain::~GCMain() {
+  for (GCThreadBuffer &buffer : buffers)
+    for (GCObj *obj : buffer.objs)
+      delete obj;
+
   for (GCObj *obj : marks) {
     delete obj;
   }
 }
 
+void GCMain::attachThread() {
+  std::lock_guard<std::mutex> lock(buffersMutex);
+  buffers.emplace_back();
+  buffers.back().gc = this;
+  currentBuffer = &buffers.back();
+}
+
+void GCMain::detachThread() {
+  if (!currentBuffer || currentBuffer->gc != this)
+    return;
+
+  std::lock_guard<std::mutex> lock(buffersMutex);
+  for (GCObj *obj : currentBuffer->objs)
+    insert(obj);
+
+  for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+    if (&*it == currentBuffer) {
+      buffers.erase(it);
+      break;
+    }
+  }
+
+  currentBuffer = nullptr;
+}
+
+void GCMain::addRoot(GCObj *const *root) {
+  roots.insert(root);
+}
+
+void GCMain::removeRoot(GCObj *const *root) {
+  roots.erase(root);
+}
+
 bool GCMain::getMarkBit() const noexcept { return markBit; }
 
+void GCMain::insert(GCObj *obj) {
+  if (freeSlots.empty()) {
+    marks.push_back(obj);
+    return;
+  }
+
+  marks[freeSlots.back()] = obj;
+  freeSlots.pop_back();
+}
+
 void GCMain::add(GCObj *obj) {
+  ++countAllocated;
+  if (currentBuffer && currentBuffer->gc == this) {
+    ++currentBuffer->countNewObjs;
+    currentBuffer->objs.push_back(obj);
+    return;
+  }
+
   ++countNewObjs;
+  insert(obj);
+}
 
-  for (size_t i = 0; i < marks.size(); ++i) {
-    if (!marks[i]) {
-      marks[i] = obj;
-      return;
-    }
-  }
+void GCMain::requestHeapDump(bool sites) noexcept {
+  heapDump.store(sites ? 2 : 1);
+}
 
-  marks.push_back(obj);
+void GCMain::beginMark() noexcept {
+  markStart = std::chrono::steady_clock::now();
+  marking = true;
 }
 
 void GCMain::collect() {
-  for (size_t i = 1; i <= marks.size(); ++i) {
-    if (marks[i - 1] && !marks[i-1]->isMarked(*this)) {
+  if (!marking)
+    markStart = std::chrono::steady_clock::now();
+
+  marking = false;
+
+  {
+    // Merge objects of attached threads
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (GCThreadBuffer &buffer : buffers) {
+      for (GCObj *obj : buffer.objs)
+        insert(obj);
+
+      buffer.objs.clear();
+      buffer.countNewObjs = 0;
+    }
+  }
+
+  for (GCObj *const *root : roots)
+    if (*root) (*root)->mark(*this);
+
+  std::chrono::steady_clock::time_point sweepStart;
+  if (tracer) {
+    sweepStart = std::chrono::steady_clock::now();
+    tracer->span("mark", "gc", markStart, sweepStart);
+  }
+
+  int dump = heapDump.exchange(0);
+  std::unique_ptr<HeapHistogram> histogram(dump ? new HeapHistogram() : nullptr);
+
+  for (std::size_t i = 0; i < marks.size(); ++i) {
+    if (histogram && marks[i] && marks[i]->isMarked(*this))
+      histogram->add(*marks[i], dump == 2);
+
+    if (marks[i] && !marks[i]->isMarked(*this)) {
       // Delete
-      delete marks[i - 1];
-      marks[i -1 ] = nullptr; // delete reference
-      --i; // Go back one position
+      delete marks[i];
+      marks[i] = nullptr; // delete reference
+      freeSlots.push_back(i);
     }
   }
 
+  countLiveObjs.store(marks.size() - freeSlots.size(),
+      std::memory_order_relaxed);
+  peakLiveObjs = std::max(peakLiveObjs, marks.size() - freeSlots.size());
+
+  if (tracer)
+    tracer->span("sweep", "gc", sweepStart, std::chrono::steady_clock::now());
+
+  if (histogram)
+    histogram->print(std::cerr);
+
   // Flip markBit (Prevents reseting all mark bits)
   markBit = !markBit;
   // Reset new object count
   countNewObjs = 0;
+
+  ++countCollections;
+  collectTime += std::chrono::steady_clock::now() - markStart;
 }
 
 std::size_t GCMain::getCountNewObjects() const noexcept {
+  if (currentBuffer && currentBuffer->gc == this)
+    return currentBuffer->countNewObjs;
+
   return countNewObjs;
 }
+
+std::size_t GCMain::getCountObjects() const noexcept {
+  return countLiveObjs.load(std::memory_order_relaxed) + getCountNewObjects();
+}
+
+std::size_t GCMain::getCountAllocated() noexcept {
+  return countAllocated;
+}
+
+std::size_t GCMain::getTotalAllocated() noexcept {
+  return totalAllocated.load(std::memory_order_relaxed)
+    + countAllocated - flushedAllocated;
+}
+
+void GCMain::flushCountAllocated() noexcept {
+  totalAllocated.fetch_add(countAllocated - flushedAllocated,
+      std::memory_order_relaxed);
+  flushedAllocated = countAllocated;
+}
+
+// HeapHistogram
+
+void HeapHistogram::add(const GCObj &obj, bool sites) noexcept {
+  std::size_t size = obj.getSize();
+  Entry &type = types[obj.getTypeName()];
+  ++type.count;
+  type.bytes += size;
+
+  if (!sites)
+    return;
+
+  std::string site = obj.getSite();
+  Entry &entry = this->sites[site.empty() ? "(unknown)" : site];
+  ++entry.count;
+  entry.bytes += size;
+}
+
+//!\return Returns entries of map sorted by bytes (descending).
+static std::vector<std::pair<std::string, HeapHistogram::Entry>> sortByBytes(
+    const std::map<std::string, HeapHistogram::Entry> &map) {
+  std::vector<std::pair<std::string, HeapHistogram::Entry>> result(
+      map.begin(), map.end());
+  std::stable_sort(result.begin(), result.end(),
+      [](const std::pair<std::string, HeapHistogram::Entry> &a,
+          const std::pair<std::string, HeapHistogram::Entry> &b) {
+        return a.second.bytes > b.second.bytes;
+      });
+
+  return result;
+}
+
+void HeapHistogram::print(std::ostream &out, std::size_t maxSites) const {
+  std::size_t count = 0, bytes = 0;
+  for (const auto &type : types) {
+    count += type.second.count;
+    bytes += type.second.bytes;
+  }
+
+  out << "Heap (" << count << " live objects, " << bytes << " bytes):"
+    << std::endl;
+  for (const auto &type : sortByBytes(types))
+    out << "  " << type.first << ": " << type.second.count << " objects, "
+      << type.second.bytes << " bytes" << std::endl;
+
+  if (sites.empty())
+    return;
+
+  out << "Allocation sites:" << std::endl;
+  std::size_t i = 0;
+  for (const auto &site : sortByBytes(sites)) {
+    if (i++ == maxSites)
+      break;
+
+    out << "  " << site.first << ": " << site.second.count << " objects, "
+      << site.second.bytes << " bytes" << std::endl;
+  }
+}
@@ -1,16 +1,84 @@
 #include "func/lexer.hpp"
 
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+
+  // Only regular files can be mapped (pipes and devices report size 0)
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+    size = info.st_size;
+    if (size == 0) // mmap fails for empty files
+      opened = true;
+    else {
+      void *memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (memory != MAP_FAILED) {
+        data = static_cast<char*>(memory);
+        madvise(memory, size, MADV_SEQUENTIAL);
+        opened = true;
+      } else
+        size = 0;
+    }
+  }
+
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data)
+    munmap(data, size);
+}
+
 Lexer::Lexer(std::istream &input, std::vector<std::string> &lines)
   : input{&input}, lineStr(), line{0}, column{0}, curchar{-2},
     lines{lines} {
   line = lines.size();
 }
 
+Lexer::Lexer(const char *begin, const char *end,
+    std::vector<std::string> &lines)
+  : input{nullptr}, source{begin}, cursor{begin}, sourceEnd{end},
+    line{0}, column{0}, curchar{-2}, lines{lines} {
+  line = lines.size();
+}
+
 Lexer::~Lexer() {
+  fillLines(); // the buffer may be gone, when the lines are needed
+}
+
+void Lexer::fillLines() {
+  if (input)
+    return;
+
+  // Every '\n' and EOF read by nextChar ends a line (like in stream mode)
+  std::size_t size = sourceEnd - source;
+  while (lines.size() < line) {
+    std::string text;
+    if (linesOffset <= size) {
+      const char *begin = source + linesOffset;
+      const char *newline = static_cast<const char*>(
+          std::memchr(begin, '\n', size - linesOffset));
+      const char *end = newline ? newline : sourceEnd;
+      text.assign(begin, end);
+      for (std::size_t tab = text.find('\t'); tab != std::string::npos;
+          tab = text.find('\t', tab + 4))
+        text.replace(tab, 1, "    ");
+
+      linesOffset = end - source + 1;
+    }
 
+    lines.push_back(std::move(text));
+  }
 }
 
-static Token identifierToken(const std::string &id) {
+static Token identifierToken(std::string_view id) {
   if (id == "if")
     return tok_if;
   if (id == "then")
@@ -26,6 +94,23 @@ static Token identifierToken(const std::string &id) {
 }
 
 int Lexer::nextChar() {
+  if (!input) {
+    // Buffer mode: The lines are added by fillLines
+    curchar = cursor != sourceEnd ? (unsigned char) *cursor++ : EOF;
+    if (curchar == '\n' || curchar == EOF) {
+      ++line;
+      column = 0;
+    } else if (curchar == '\t') {
+      column += 4;
+      token_end += 4;
+    } else {
+      ++column;
+      ++token_end;
+    }
+
+    return curchar;
+  }
+
   curchar = input->get();
 
   if (curchar == '\n' || curchar == EOF) {
@@ -202,18 +287,33 @@ Token Lexer::nextToken() {
 
   if (isalpha(curchar)) {
     // Identifier
+    if (!input) {
+      // Slice of the buffer (copied by currentIdentifier)
+      const char *start = cursor - 1;
+      while (isalpha(curchar) || curchar == '_' || isdigit(curchar))
+        nextChar(); // Eat alpha.
+
+      const char *end = curchar == EOF ? cursor : cursor - 1;
+      curidView = std::string_view(start, end - start);
+      curidCopied = false;
+      return curtok = identifierToken(curidView);
+    }
+
     curid = "";
     while (isalpha(curchar) || curchar == '_' || isdigit(curchar)) {
       curid += curchar;
       nextChar(); // Eat alpha.
     }
 
+    curidView = curid;
+    curidCopied = true;
     return curtok = identifierToken(curid);
   }
 
   if (curchar == '"') {
     nextChar(); // eat "
     // identifier
+    curidCopied = true;
     curid = "\"";
     while (curchar != '"' && curchar != '\n' && curchar != EOF) {
       curid += curchar;
@@ -230,11 +330,21 @@ Token Lexer::nextToken() {
 
     curid += "\"";
 
+    curidView = curid;
+    curidCopied = true;
     return curtok = identifierToken(curid);
   }
 
   if (curchar == '-') { // Comment
-    while (curchar != '\n') nextChar();
+    if (!input) {
+      // Skip to the end of the line at once (columns don't matter anymore)
+      const char *newline = static_cast<const char*>(
+          std::memchr(cursor, '\n', sourceEnd - cursor));
+      cursor = newline ? newline : sourceEnd;
+      nextChar();
+    }
+
+    while (curchar != '\n' && curchar != EOF) nextChar();
   }
 
   if (curchar == '\n') {
@@ -273,6 +383,11 @@ std::int64_t Lexer::currentInteger() const noexcept {
 }
 
 const std::string &Lexer::currentIdentifier() const noexcept {
+  if (!curidCopied) {
+    curid.assign(curidView.data(), curidView.size());
+    curidCopied = true;
+  }
+
   return curid;
 }
 
@@ -289,6 +404,7 @@ Token Lexer::reportError(const std::string &msg, const TokenPos &pos) noexcept {
   // Advance to next line
   while (curchar != -2 && curchar != '\n' && curchar != EOF) nextChar();
   if (curchar != EOF) curchar = -2; // last was new line
+  fillLines();
 
   if (curtok == tok_eof || curchar == EOF)
     std::cerr << std::endl;
@@ -1,21 +1,150 @@
 #include "func/func.hpp"
 
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program
+    << " [--opt-level N] [--opt-stats] [--typecheck] [--threads N]"
+    << " [--parallel-guards] [--max-steps N] [--timeout MS]"
+    << " [--max-objects N] [--stats] [--profile] [--trace FILE]"
+    << " [--sample FILE] [file]" << std::endl;
+}
+
+static void handleInterrupt(int signal) {
+  // Without a running evaluation Ctrl+C terminates the interpreter
+  if (!interruptEvaluation()) {
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+  }
+}
+
+//! Collector of the interpreter (for SIGUSR1)
+static GCMain *mainGC = nullptr;
+
+static void handleHeapDump(int signal) {
+  // Printed by the next collection
+  if (mainGC)
+    mainGC->requestHeapDump(true);
+}
+
 int main(int vargsc, char * vargs[]) {
   std::vector<std::string> lines;
 
-  GCMain gc;
-  Environment *env = new Environment(gc);
-  if (vargsc == 2) {
-    std::ifstream input;
-    input.open(vargs[1]);
+  int optLevel = 1;
+  bool optStats = false;
+  bool typeCheck = false;
+  int threads = 1;
+  bool parallelGuards = false;
+  EvalLimits limits;
+  std::size_t maxObjects = 0;
+  bool profile = false;
+  bool stats = false;
+  const char *traceFile = nullptr;
+  const char *sampleFile = nullptr;
+  const char *filename = nullptr;
+  for (int i = 1; i < vargsc; ++i) {
+    std::string arg = vargs[i];
+    if (arg == "--opt-level" && i + 1 < vargsc) {
+      optLevel = std::atoi(vargs[++i]);
+    } else if (arg == "--opt-stats") {
+      optStats = true;
+    } else if (arg == "--typecheck") {
+      typeCheck = true;
+    } else if (arg == "--threads" && i + 1 < vargsc) {
+      threads = std::atoi(vargs[++i]);
+    } else if (arg == "--parallel-guards") {
+      parallelGuards = true;
+    } else if (arg == "--max-steps" && i + 1 < vargsc) {
+      limits.maxSteps = std::strtoull(vargs[++i], nullptr, 10);
+    } else if (arg == "--timeout" && i + 1 < vargsc) {
+      limits.timeout = std::atof(vargs[++i]);
+    } else if (arg == "--max-objects" && i + 1 < vargsc) {
+      maxObjects = std::strtoull(vargs[++i], nullptr, 10);
+    } else if (arg == "--stats") {
+      stats = true;
+    } else if (arg == "--profile") {
+      profile = true;
+    } else if (arg == "--trace" && i + 1 < vargsc) {
+      traceFile = vargs[++i];
+    } else if (arg == "--sample" && i + 1 < vargsc) {
+      sampleFile = vargs[++i];
+    } else if (arg[0] != '-' && !filename) {
+      filename = vargs[i];
+    } else {
+      printUsage(vargs[0]);
+      return 1;
+    }
+  }
 
-    if (!input) {
-      std::cerr << "Failed opening file \"" << vargs[1] << "\"." << std::endl;
+  Optimizer optimizer(optLevel, typeCheck);
+
+  std::unique_ptr<Tracer> tracer;
+  if (traceFile) {
+    tracer.reset(new Tracer(traceFile));
+    if (!tracer->isOpen()) {
+      std::cerr << "Failed opening file \"" << traceFile << "\"." << std::endl;
       return 1;
     }
+  }
+
+  // Outlived by the tracer
+  GCMain gc;
+  gc.setTracer(tracer.get());
+  gc.setMaxObjects(maxObjects);
+  std::unique_ptr<ThreadPool> pool;
+  if (threads > 1) {
+    pool.reset(new ThreadPool(gc, threads));
+    pool->setParallelGuards(parallelGuards);
+  }
 
-    interpret(input, gc, lines, env);
+  Profiler profiler;
+  std::unique_ptr<Sampler> sampler;
+  if (sampleFile)
+    sampler.reset(new Sampler());
+
+  Environment *env = new Environment(gc);
+  env->optimizer = &optimizer;
+  env->pool = pool.get();
+  env->profiler = profile ? &profiler : nullptr;
+  env->tracer = tracer.get();
+
+  // Ctrl+C stops the running evaluation (the environment is kept)
+  std::signal(SIGINT, handleInterrupt);
+  mainGC = &gc;
+  std::signal(SIGUSR1, handleHeapDump);
+
+  if (filename) {
+    MappedFile file(filename);
+
+    if (file.isOpen())
+      interpret(file, gc, lines, env, limits);
+    else {
+      // Not mappable (e.g. a pipe): stream it
+      std::ifstream input;
+      input.open(filename);
+
+      if (!input) {
+        std::cerr << "Failed opening file \"" << filename << "\"." << std::endl;
+        return 1;
+      }
+
+      interpret(input, gc, lines, env, false, limits);
+    }
   };
 
-  return interpret(std::cin, gc, lines, env, true) ? 0 : 1;
+  bool success = interpret(std::cin, gc, lines, env, true, limits);
+
+  if (optStats)
+    optimizer.printStatistics(std::cerr);
+
+  if (stats)
+    getEvalStats().print(std::cerr);
+
+  if (profile)
+    profiler.print(std::cerr);
+
+  if (sampler) {
+    std::ofstream sampleOutput(sampleFile);
+    sampler->write(sampleOutput, lines);
+  }
+
+  return success ? 0 : 1;
 }
@@ -0,0 +1,738 @@
+#include "func/optimizer.hpp"
+#include "func/typecheck.hpp"
+#include "func/builtin.hpp"
+
+bool isBound(const Scope &scope, const std::string &name) noexcept {
+  for (const std::string &id : scope)
+    if (id == name) return true;
+
+  return false;
+}
+
+static bool isLiteral(const Expr *expr) noexcept {
+  switch (expr->getExpressionType()) {
+  case expr_int:
+  case expr_num:
+  case expr_atom:
+    return true;
+  }
+
+  return false;
+}
+
+static bool contains(const std::vector<std::string> &ids,
+    const std::string &name) noexcept {
+  for (const std::string &id : ids)
+    if (id == name) return true;
+
+  return false;
+}
+
+static std::size_t count(const std::vector<std::string> &ids,
+    const std::string &name) noexcept {
+  std::size_t result = 0;
+  for (const std::string &id : ids)
+    if (id == name) ++result;
+
+  return result;
+}
+
+/*!\return Returns true if needle is a subexpression of expr.
+ */
+static bool containsExpr(const Expr *expr, const Expr *needle) noexcept {
+  if (expr == needle)
+    return true;
+
+  switch (expr->getExpressionType()) {
+  case expr_biop: {
+      auto biop = dynamic_cast<const BiOpExpr*>(expr);
+      return containsExpr(&biop->getLHS(), needle)
+        || containsExpr(&biop->getRHS(), needle);
+    }
+  case expr_unop:
+    return containsExpr(
+        &dynamic_cast<const UnOpExpr*>(expr)->getExpression(), needle);
+  case expr_lambda:
+    return containsExpr(
+        &dynamic_cast<const LambdaExpr*>(expr)->getExpression(), needle);
+  case expr_if: {
+      auto ifexpr = dynamic_cast<const IfExpr*>(expr);
+      return containsExpr(&ifexpr->getCondition(), needle)
+        || containsExpr(&ifexpr->getTrue(), needle)
+        || containsExpr(&ifexpr->getFalse(), needle);
+    }
+  case expr_let: {
+      auto letexpr = dynamic_cast<const LetExpr*>(expr);
+      for (BiOpExpr *asg : letexpr->getAssignments())
+        if (containsExpr(asg, needle)) return true;
+
+      return containsExpr(&letexpr->getBody(), needle);
+    }
+  case expr_thunk:
+    return containsExpr(
+        &dynamic_cast<const ThunkExpr*>(expr)->getExpression(), needle);
+  }
+
+  return false;
+}
+
+/*!\return Returns true if fn is the builtin print.
+ */
+static bool isPrint(Environment &env, const Expr *fn,
+    const Scope &scope) noexcept {
+  if (fn->getExpressionType() == expr_builtin)
+    return dynamic_cast<const BuiltinExpr*>(fn)->getBuiltin().name == "print";
+
+  return fn->getExpressionType() == expr_id
+    && dynamic_cast<const IdExpr*>(fn)->getName() == "print"
+    && !isBound(scope, "print") && !env.get("print");
+}
+
+// OptimizerPass
+
+Expr *OptimizerPass::run(GCMain &gc, Environment &env, Expr *expr) noexcept {
+  auto startTime = std::chrono::steady_clock::now();
+
+  Expr *result = apply(gc, env, expr);
+
+  std::chrono::duration<double, std::milli> diffTime =
+    std::chrono::steady_clock::now() - startTime;
+  consumedTime += diffTime.count();
+
+  return result;
+}
+
+Expr *OptimizerPass::apply(GCMain &gc, Environment &env, Expr *expr) noexcept {
+  Scope scope;
+  return transform(gc, env, expr, scope);
+}
+
+Expr *OptimizerPass::transform(GCMain &gc, Environment &env, Expr *expr,
+    Scope &scope) noexcept {
+  Expr *node = expr;
+  const std::size_t scopeSize = scope.size();
+
+  switch (expr->getExpressionType()) {
+  case expr_biop: {
+      BiOpExpr *biop = dynamic_cast<BiOpExpr*>(expr);
+      Expr *lhs = const_cast<Expr*>(&biop->getLHS());
+      Expr *rhs = const_cast<Expr*>(&biop->getRHS());
+
+      Expr *newlhs = lhs;
+      Expr *newrhs = rhs;
+      if (biop->getOperator() == op_asg) {
+        // LHS is a pattern (never optimized), its identifiers are bound in
+        // the RHS (function parameters)
+        for (std::string &id : lhs->getIdentifiers())
+          scope.push_back(id);
+
+        newrhs = transform(gc, env, rhs, scope);
+      } else {
+        newlhs = transform(gc, env, lhs, scope);
+        // print outputs its argument unevaluated, keep it as written
+        if (biop->getOperator() != op_fn || !isPrint(env, newlhs, scope))
+          newrhs = transform(gc, env, rhs, scope);
+      }
+
+      scope.resize(scopeSize);
+
+      if (newlhs != lhs || newrhs != rhs)
+        node = new BiOpExpr(gc, biop->getTokenPos(), biop->getOperator(),
+            newlhs, newrhs);
+      break;
+    }
+  case expr_unop: {
+      UnOpExpr *unop = dynamic_cast<UnOpExpr*>(expr);
+      Expr *subexpr = const_cast<Expr*>(&unop->getExpression());
+      Expr *newexpr = transform(gc, env, subexpr, scope);
+      if (newexpr != subexpr)
+        node = new UnOpExpr(gc, unop->getTokenPos(), unop->getOperator(),
+            newexpr);
+      break;
+    }
+  case expr_lambda: {
+      LambdaExpr *lambda = dynamic_cast<LambdaExpr*>(expr);
+      Expr *body = const_cast<Expr*>(&lambda->getExpression());
+
+      scope.push_back(lambda->getName());
+      Expr *newbody = transform(gc, env, body, scope);
+      scope.resize(scopeSize);
+
+      if (newbody != body)
+        node = new LambdaExpr(gc, lambda->getTokenPos(), lambda->getName(),
+            newbody);
+      break;
+    }
+  case expr_if: {
+      IfExpr *ifexpr = dynamic_cast<IfExpr*>(expr);
+      Expr *condition = const_cast<Expr*>(&ifexpr->getCondition());
+      Expr *exprTrue = const_cast<Expr*>(&ifexpr->getTrue());
+      Expr *exprFalse = const_cast<Expr*>(&ifexpr->getFalse());
+
+      Expr *newcondition = transform(gc, env, condition, scope);
+      Expr *newTrue = transform(gc, env, exprTrue, scope);
+      Expr *newFalse = transform(gc, env, exprFalse, scope);
+      if (newcondition != condition
+          || newTrue != exprTrue || newFalse != exprFalse)
+        node = new IfExpr(gc, ifexpr->getTokenPos(),
+            newcondition, newTrue, newFalse, ifexpr->isCaseGuard());
+      break;
+    }
+  case expr_let: {
+      LetExpr *letexpr = dynamic_cast<LetExpr*>(expr);
+
+      // All identifiers assigned are bound in the assignments and the body
+      for (BiOpExpr *asg : letexpr->getAssignments())
+        for (std::string &id : asg->getLHS().getIdentifiers())
+          scope.push_back(id);
+
+      bool changed = false;
+      std::vector<BiOpExpr*> newassignments;
+      for (BiOpExpr *asg : letexpr->getAssignments()) {
+        Expr *rhs = const_cast<Expr*>(&asg->getRHS());
+        Expr *newrhs = transform(gc, env, rhs, scope);
+        if (newrhs != rhs) {
+          changed = true;
+          newassignments.push_back(new BiOpExpr(gc, asg->getTokenPos(),
+                op_asg, const_cast<Expr*>(&asg->getLHS()), newrhs));
+        } else
+          newassignments.push_back(asg);
+      }
+
+      Expr *body = const_cast<Expr*>(&letexpr->getBody());
+      Expr *newbody = transform(gc, env, body, scope);
+      scope.resize(scopeSize);
+
+      if (changed || newbody != body)
+        node = new LetExpr(gc, letexpr->getTokenPos(), newassignments,
+            newbody);
+      break;
+    }
+  }
+
+  Expr *result = rewrite(gc, env, node, scope);
+  if (result != node)
+    ++rewrites;
+
+  return result;
+}
+
+// Passes
+
+/*!\brief Shares equal subtrees and prunes if-then-else expressions with atom
+ * conditions (Expr::optimize).
+ */
+class SharingPass : public OptimizerPass {
+protected:
+  virtual Expr *apply(GCMain &gc, Environment &env, Expr *expr) noexcept override {
+    Expr *result = expr->optimize(gc);
+    if (result != expr)
+      ++rewrites;
+
+    return result;
+  }
+public:
+  virtual const char *getName() const noexcept override
+    { return "subtree-sharing"; }
+};
+
+/*!\brief Folds arithmetic, comparisons and if-then-else expressions with
+ * literal operands.
+ */
+class ConstantFoldingPass : public OptimizerPass {
+protected:
+  virtual Expr *rewrite(GCMain &gc, Environment &env, Expr *expr,
+      const Scope &scope) noexcept override {
+    switch (expr->getExpressionType()) {
+    case expr_biop: {
+        BiOpExpr *biop = dynamic_cast<BiOpExpr*>(expr);
+        const Expr &lhs = biop->getLHS();
+        const Expr &rhs = biop->getRHS();
+        switch (biop->getOperator()) {
+        case op_asg:
+        case op_fn:
+        case op_land:
+        case op_lor:
+          return expr;
+        case op_eq:
+          if (isLiteral(&lhs) && isLiteral(&rhs))
+            return biop->evalValue(gc, env).toExpr(gc, expr->getTokenPos());
+          return expr;
+        case op_div:
+          // Keep division by zero for runtime
+          if (rhs.getExpressionType() == expr_int
+              && dynamic_cast<const IntExpr&>(rhs).getNumber() == 0)
+            return expr;
+        }
+
+        // Only fold if evaluation would succeed
+        if (lhs.getExpressionType() != rhs.getExpressionType()
+            || (lhs.getExpressionType() != expr_int
+              && lhs.getExpressionType() != expr_num))
+          return expr;
+
+        return biop->evalValue(gc, env).toExpr(gc, expr->getTokenPos());
+      }
+    case expr_unop: {
+        UnOpExpr *unop = dynamic_cast<UnOpExpr*>(expr);
+        ExprType type = unop->getExpression().getExpressionType();
+        if ((type != expr_int && type != expr_num)
+            || (unop->getOperator() != op_add && unop->getOperator() != op_sub))
+          return expr;
+
+        return unop->evalValue(gc, env).toExpr(gc, expr->getTokenPos());
+      }
+    case expr_if: {
+        IfExpr *ifexpr = dynamic_cast<IfExpr*>(expr);
+        if (ifexpr->getCondition().getExpressionType() != expr_atom)
+          return expr;
+
+        if (dynamic_cast<const AtomExpr&>(ifexpr->getCondition()).getName() != "false")
+          return const_cast<Expr*>(&ifexpr->getTrue());
+
+        return const_cast<Expr*>(&ifexpr->getFalse());
+      }
+    }
+
+    return expr;
+  }
+public:
+  virtual const char *getName() const noexcept override
+    { return "constant-folding"; }
+};
+
+/*!\brief Folds '&&' and '||' with atom operands.
+ */
+class BooleanFoldingPass : public OptimizerPass {
+protected:
+  virtual Expr *rewrite(GCMain &gc, Environment &env, Expr *expr,
+      const Scope &scope) noexcept override {
+    if (expr->getExpressionType() != expr_biop)
+      return expr;
+
+    BiOpExpr *biop = dynamic_cast<BiOpExpr*>(expr);
+    if (biop->getOperator() != op_land && biop->getOperator() != op_lor)
+      return expr;
+
+    if (biop->getLHS().getExpressionType() != expr_atom)
+      return expr;
+
+    bool lhs = dynamic_cast<const AtomExpr&>(biop->getLHS()).getName() != "false";
+    // Result doesn't depend on RHS
+    if (biop->getOperator() == op_land && !lhs)
+      return new AtomExpr(gc, expr->getTokenPos(), "false");
+    if (biop->getOperator() == op_lor && lhs)
+      return new AtomExpr(gc, expr->getTokenPos(), "true");
+
+    if (biop->getRHS().getExpressionType() != expr_atom)
+      return expr;
+
+    bool rhs = dynamic_cast<const AtomExpr&>(biop->getRHS()).getName() != "false";
+    return new AtomExpr(gc, expr->getTokenPos(), rhs ? "true" : "false");
+  }
+public:
+  virtual const char *getName() const noexcept override
+    { return "boolean-folding"; }
+};
+
+/*!\brief Removes identifier assignments of let expressions, which are used
+ * nowhere.
+ */
+class DeadLetPass : public OptimizerPass {
+protected:
+  virtual Expr *rewrite(GCMain &gc, Environment &env, Expr *expr,
+      const Scope &scope) noexcept override {
+    if (expr->getExpressionType() != expr_let)
+      return expr;
+
+    LetExpr *letexpr = dynamic_cast<LetExpr*>(expr);
+    const std::vector<BiOpExpr*> &assignments = letexpr->getAssignments();
+
+    std::vector<std::string> used = letexpr->getBody().getIdentifiers();
+    for (BiOpExpr *asg : assignments)
+      for (std::string &id : asg->getRHS().getIdentifiers())
+        used.push_back(id);
+
+    std::vector<BiOpExpr*> newassignments;
+    for (BiOpExpr *asg : assignments) {
+      // Pattern matching might fail, keep it
+      if (asg->getLHS().getExpressionType() != expr_id
+          || contains(used, dynamic_cast<const IdExpr&>(asg->getLHS()).getName()))
+        newassignments.push_back(asg);
+    }
+
+    if (newassignments.size() == assignments.size())
+      return expr; // no changes
+
+    Expr *body = const_cast<Expr*>(&letexpr->getBody());
+    if (newassignments.empty())
+      return body;
+
+    return new LetExpr(gc, letexpr->getTokenPos(), newassignments, body);
+  }
+public:
+  virtual const char *getName() const noexcept override
+    { return "dead-let-elimination"; }
+};
+
+/*!\return Returns true if arg can be substituted for name into body without
+ * duplicating work or capturing identifiers.
+ */
+static bool isSubstitutable(const Expr *body, const std::string &name,
+    const Expr *arg) noexcept {
+  std::vector<std::string> ids = body->getIdentifiers();
+  if (arg->getExpressionType() == expr_id)
+    return !contains(ids, dynamic_cast<const IdExpr*>(arg)->getName())
+      || dynamic_cast<const IdExpr*>(arg)->getName() == name;
+
+  if (isLiteral(arg) || arg->getExpressionType() == expr_any)
+    return true;
+
+  return count(ids, name) == 0;
+}
+
+/*!\return Returns the named function applied in expr (nullptr if expr
+ * isn't an application of a named function).
+ * \param args Arguments of the application.
+ */
+static const FunctionExpr *getNamedFunction(Environment &env, const Expr *expr,
+    const Scope &scope, std::vector<Expr*> &args) noexcept {
+  const Expr *fn = expr;
+  while (fn->getExpressionType() == expr_biop
+      && dynamic_cast<const BiOpExpr*>(fn)->getOperator() == op_fn) {
+    args.insert(args.begin(),
+        const_cast<Expr*>(&dynamic_cast<const BiOpExpr*>(fn)->getRHS()));
+    fn = &dynamic_cast<const BiOpExpr*>(fn)->getLHS();
+  }
+
+  if (args.empty() || fn->getExpressionType() != expr_id)
+    return nullptr;
+
+  const std::string &fnname = dynamic_cast<const IdExpr*>(fn)->getName();
+  if (isBound(scope, fnname))
+    return nullptr; // not the named function
+
+  const Expr *value = env.get(fnname);
+  if (!value || value->getExpressionType() != expr_fn)
+    return nullptr;
+
+  return dynamic_cast<const FunctionExpr*>(value);
+}
+
+/*!\brief Substitutes arguments of applied literal lambda functions.
+ */
+class BetaReductionPass : public OptimizerPass {
+protected:
+  virtual Expr *rewrite(GCMain &gc, Environment &env, Expr *expr,
+      const Scope &scope) noexcept override {
+    if (expr->getExpressionType() != expr_biop)
+      return expr;
+
+    BiOpExpr *biop = dynamic_cast<BiOpExpr*>(expr);
+    if (biop->getOperator() != op_fn
+        || biop->getLHS().getExpressionType() != expr_lambda)
+      return expr;
+
+    auto lambda = dynamic_cast<const LambdaExpr*>(&biop->getLHS());
+    Expr *arg = const_cast<Expr*>(&biop->getRHS());
+    if (!isSubstitutable(&lambda->getExpression(), lambda->getName(), arg))
+      return expr;
+
+    return lambda->replace(gc, arg);
+  }
+public:
+  virtual const char *getName() const noexcept override
+    { return "beta-reduction"; }
+};
+
+/*!\brief Inlines saturated applications of small non-recursive named
+ * functions with one case and only identifiers or '_' as parameters.
+ */
+class InliningPass : public OptimizerPass {
+  static const std::size_t maxDepth = 32; //!< Maximum size of inlined body
+protected:
+  virtual Expr *rewrite(GCMain &gc, Environment &env, Expr *expr,
+      const Scope &scope) noexcept override {
+    if (expr->getExpressionType() != expr_biop
+        || dynamic_cast<BiOpExpr*>(expr)->getOperator() != op_fn)
+      return expr;
+
+    std::vector<Expr*> args;
+    const FunctionExpr *fnexpr = getNamedFunction(env, expr, scope, args);
+    if (!fnexpr || fnexpr->getFunctionCases().size() != 1)
+      return expr;
+
+    const std::pair<std::vector<Expr*>, Expr*> &fncase =
+      fnexpr->getFunctionCases().front();
+    if (fncase.first.size() != args.size() // only saturated applications
+        || fncase.second->getDepth() > maxDepth
+        || containsExpr(fncase.second, fnexpr)) // recursive
+      return expr;
+
+    std::vector<std::string> params;
+    for (Expr *param : fncase.first) {
+      if (param->getExpressionType() == expr_id)
+        params.push_back(dynamic_cast<IdExpr*>(param)->getName());
+      else if (param->getExpressionType() == expr_any)
+        params.push_back(std::string());
+      else
+        return expr; // pattern matching
+    }
+
+    // Identifiers of the body must refer to the same as in the function
+    for (std::string &id : fncase.second->getIdentifiers())
+      if (!contains(params, id) && isBound(scope, id))
+        return expr;
+
+    // Arguments must not contain parameters substituted afterwards
+    for (Expr *arg : args)
+      for (std::string &id : arg->getIdentifiers())
+        if (contains(params, id))
+          return expr;
+
+    Expr *result = fncase.second;
+    for (std::size_t i = 0; i < params.size(); ++i) {
+      if (params[i].empty())
+        continue;
+
+      if (!isSubstitutable(result, params[i], args[i]))
+        return expr;
+
+      result = result->replace(gc, params[i], args[i]);
+    }
+
+    return result;
+  }
+public:
+  virtual const char *getName() const noexcept override
+    { return "inlining"; }
+};
+
+/*!\return Returns true if expr is a number, an atom or an atom
+ * constructor with constant arguments.
+ */
+static bool isConstant(const Expr *expr) noexcept {
+  if (isLiteral(expr))
+    return true;
+
+  if (expr->getExpressionType() != expr_biop)
+    return false;
+
+  auto biop = dynamic_cast<const BiOpExpr*>(expr);
+  if (biop->getOperator() != op_fn || !isConstant(&biop->getRHS()))
+    return false;
+
+  const Expr *lhs = &biop->getLHS();
+  return lhs->getExpressionType() == expr_atom
+    || (lhs->getExpressionType() == expr_biop && isConstant(lhs));
+}
+
+enum MatchResult { match_yes, match_no, match_unknown };
+
+/*!\brief Matches a function case parameter against a constant argument
+ * (like the equality check and let statement created by FunctionExpr::eval).
+ * \param bindings Identifiers of pattern bound to parts of arg.
+ */
+static MatchResult matchConstant(const Expr *pattern, Expr *arg,
+    std::vector<std::pair<std::string, Expr*>> &bindings) noexcept {
+  switch (pattern->getExpressionType()) {
+  case expr_any:
+    return match_yes;
+  case expr_id:
+    bindings.emplace_back(dynamic_cast<const IdExpr*>(pattern)->getName(), arg);
+    return match_yes;
+  case expr_int:
+    if (arg->getExpressionType() == expr_int)
+      return dynamic_cast<const IntExpr*>(pattern)->getNumber()
+        == dynamic_cast<IntExpr*>(arg)->getNumber() ? match_yes : match_no;
+    if (arg->getExpressionType() == expr_num)
+      return match_unknown;
+    return match_no;
+  case expr_num:
+    if (arg->getExpressionType() == expr_num)
+      return dynamic_cast<const NumExpr*>(pattern)->getNumber()
+        == dynamic_cast<NumExpr*>(arg)->getNumber() ? match_yes : match_no;
+    if (arg->getExpressionType() == expr_int)
+      return match_unknown;
+    return match_no;
+  case expr_atom:
+    if (arg->getExpressionType() == expr_atom)
+      return dynamic_cast<const AtomExpr*>(pattern)->getName()
+        == dynamic_cast<AtomExpr*>(arg)->getName() ? match_yes : match_no;
+    return match_no;
+  case expr_biop: {
+      auto biop = dynamic_cast<const BiOpExpr*>(pattern);
+      if (!biop->isAtomConstructor())
+        return match_unknown;
+
+      if (arg->getExpressionType() != expr_biop)
+        return match_no;
+
+      auto argbiop = dynamic_cast<BiOpExpr*>(arg);
+      MatchResult lhs = matchConstant(&biop->getLHS(),
+          const_cast<Expr*>(&argbiop->getLHS()), bindings);
+      MatchResult rhs = matchConstant(&biop->getRHS(),
+          const_cast<Expr*>(&argbiop->getRHS()), bindings);
+      if (lhs == match_no || rhs == match_no)
+        return match_no;
+      if (lhs == match_unknown || rhs == match_unknown)
+        return match_unknown;
+
+      return match_yes;
+    }
+  }
+
+  return match_unknown;
+}
+
+/*!\brief Replaces applications of named functions with constant arguments by
+ * the body of the selected function case (cached in the FunctionExpr).
+ */
+class SpecializationPass : public OptimizerPass {
+  static const std::size_t maxDepth = 64; //!< Maximum size of residual body
+
+  /*!\return Returns the specialization of fnexpr for args.
+   */
+  FunctionExpr::Specialization specialize(GCMain &gc,
+      const FunctionExpr *fnexpr, const std::vector<Expr*> &args) noexcept {
+    for (auto &fncase : fnexpr->getFunctionCases()) {
+      FunctionExpr::Specialization spec;
+      std::vector<std::pair<std::string, Expr*>> bindings;
+      MatchResult result = match_yes;
+      for (std::size_t i = 0; i < args.size() && result == match_yes; ++i) {
+        const Expr *param = fncase.first[i];
+        if (isConstant(args[i])) {
+          result = matchConstant(param, args[i], bindings);
+        } else if (param->getExpressionType() == expr_id) {
+          spec.params.push_back(dynamic_cast<const IdExpr*>(param)->getName());
+        } else if (param->getExpressionType() == expr_any) {
+          spec.params.push_back(std::string());
+        } else
+          result = match_unknown; // depends on runtime value
+      }
+
+      if (result == match_no)
+        continue; // try next case
+      if (result == match_unknown)
+        break;
+
+      spec.body = fncase.second;
+      for (auto &binding : bindings)
+        spec.body = spec.body->replace(gc, binding.first, binding.second);
+
+      if (spec.body->getDepth() > maxDepth)
+        break;
+
+      return spec;
+    }
+
+    return FunctionExpr::Specialization{{}, nullptr};
+  }
+protected:
+  virtual Expr *rewrite(GCMain &gc, Environment &env, Expr *expr,
+      const Scope &scope) noexcept override {
+    std::vector<Expr*> args;
+    const FunctionExpr *fnexpr = getNamedFunction(env, expr, scope, args);
+    if (!fnexpr || fnexpr->getFunctionCases().front().first.size() != args.size())
+      return expr;
+
+    std::string key;
+    std::vector<Expr*> remainingArgs;
+    for (Expr *arg : args) {
+      if (isConstant(arg))
+        key += "(" + arg->toString() + ") ";
+      else {
+        key += "_ ";
+        remainingArgs.push_back(arg);
+      }
+    }
+
+    if (remainingArgs.size() == args.size())
+      return expr; // no constant arguments
+
+    const FunctionExpr::Specialization *spec = fnexpr->getSpecialization(key);
+    if (!spec) {
+      const_cast<FunctionExpr*>(fnexpr)->addSpecialization(key,
+          specialize(gc, fnexpr, args));
+      spec = fnexpr->getSpecialization(key);
+    }
+
+    if (!spec->body)
+      return expr;
+
+    // Identifiers of the body must refer to the same as in the function
+    for (std::string &id : spec->body->getIdentifiers())
+      if (!contains(spec->params, id) && isBound(scope, id))
+        return expr;
+
+    // Arguments must not contain parameters substituted afterwards
+    for (Expr *arg : remainingArgs)
+      for (std::string &id : arg->getIdentifiers())
+        if (contains(spec->params, id))
+          return expr;
+
+    Expr *result = spec->body;
+    std::vector<std::size_t> delayed;
+    for (std::size_t i = 0; i < spec->params.size(); ++i) {
+      if (spec->params[i].empty())
+        continue;
+
+      if (isSubstitutable(result, spec->params[i], remainingArgs[i]))
+        result = result->replace(gc, spec->params[i], remainingArgs[i]);
+      else
+        delayed.push_back(i);
+    }
+
+    // Remaining arguments are passed by lambda substitution
+    for (auto it = delayed.rbegin(); it != delayed.rend(); ++it) {
+      result = new BiOpExpr(gc, expr->getTokenPos(), op_fn,
+          new LambdaExpr(gc, expr->getTokenPos(), spec->params[*it], result),
+          remainingArgs[*it]);
+    }
+
+    return result;
+  }
+public:
+  virtual const char *getName() const noexcept override
+    { return "specialization"; }
+};
+
+// Optimizer
+
+Optimizer::Optimizer(int level, bool typeCheck) : level{level}, passes() {
+  if (level >= 2) {
+    passes.emplace_back(new SpecializationPass());
+    passes.emplace_back(new InliningPass());
+    passes.emplace_back(new BetaReductionPass());
+  }
+
+  if (level >= 1) {
+    passes.emplace_back(new ConstantFoldingPass());
+    passes.emplace_back(new BooleanFoldingPass());
+    passes.emplace_back(new DeadLetPass());
+    passes.emplace_back(new SharingPass());
+  }
+
+  // Annotates the final expression
+  if (typeCheck)
+    passes.emplace_back(new TypeInferencePass());
+}
+
+Expr *Optimizer::run(GCMain &gc, Environment &env, Expr *expr) noexcept {
+  for (std::unique_ptr<OptimizerPass> &pass : passes) {
+    expr = pass->run(gc, env, expr);
+    if (!expr)
+      return nullptr; // error forwarding
+  }
+
+  return expr;
+}
+
+void Optimizer::printStatistics(std::ostream &out) const {
+  out << "Optimizer (level " << level << "):" << std::endl;
+  for (const std::unique_ptr<OptimizerPass> &pass : passes) {
+    out << "  " << pass->getName() << ": "
+      << pass->getRewrites() << " rewrites, "
+      << pass->getConsumedTime() << " ms" << std::endl;
+  }
+}
@@ -0,0 +1,538 @@
+#include "func/parallel.hpp"
+#include "func/sampler.hpp"
+
+//! Worker of the current thread (nullptr if not in a pool)
+static thread_local void *currentWorker = nullptr;
+//! Task evaluated by the current thread (nullptr if none)
+static thread_local const EvalTask *currentTask = nullptr;
+
+//! Count of new objects, which triggers a collection
+static const std::size_t collectThreshold = 200;
+
+ThreadPool::ThreadPool(GCMain &gc, std::size_t threads)
+    : gc(gc), active(1) {
+
+  if (threads == 0) threads = 1;
+  for (std::size_t i = 0; i < threads; ++i)
+    workers.emplace_back(new Worker());
+
+  currentWorker = workers[0].get();
+  for (std::size_t i = 1; i < threads; ++i)
+    workers[i]->thread = std::thread(&ThreadPool::workerLoop, this,
+        workers[i].get());
+}
+
+ThreadPool::~ThreadPool() {
+  // Workers may still evaluate futures (and collect)
+  leave(workers[0].get(), nullptr);
+
+  {
+    std::lock_guard<std::mutex> lock(idleMutex);
+    stopping = true;
+  }
+  idleCV.notify_all();
+  for (std::size_t i = 1; i < workers.size(); ++i)
+    workers[i]->thread.join();
+
+  currentWorker = nullptr;
+}
+
+void ThreadPool::workerLoop(Worker *self) noexcept {
+  currentWorker = self;
+  gc.attachThread();
+  enter(self, nullptr);
+
+  while (!stopping.load(std::memory_order_relaxed)) {
+    if (EvalTask *task = steal(self)) {
+      run(task);
+      continue;
+    }
+
+    leave(self, nullptr);
+    {
+      std::unique_lock<std::mutex> lock(idleMutex);
+      ++idle;
+      idleCV.wait(lock, [this] {
+            return queued.load() > 0 || stopping.load();
+          });
+      --idle;
+    }
+    enter(self, nullptr);
+  }
+
+  gc.detachThread(); // must not run concurrently to a collection
+  leave(self, nullptr);
+}
+
+void ThreadPool::leave(Worker *self, Environment *env) noexcept {
+  std::lock_guard<std::mutex> lock(gcMutex);
+  if (env) self->envs.push_back(env);
+
+  --active;
+  if (stopRequested.load())
+    gcCV.notify_all();
+}
+
+void ThreadPool::enter(Worker *self, Environment *env) noexcept {
+  std::unique_lock<std::mutex> lock(gcMutex);
+  gcCV.wait(lock, [this] { return !stopRequested.load(); });
+
+  ++active;
+  if (env) self->envs.pop_back();
+}
+
+EvalTask *ThreadPool::steal(Worker *self) noexcept {
+  if (queued.load(std::memory_order_relaxed) == 0)
+    return nullptr;
+
+  {
+    std::lock_guard<std::mutex> lock(self->mutex);
+    if (!self->tasks.empty()) {
+      EvalTask *task = self->tasks.back();
+      self->tasks.pop_back();
+      --queued;
+      return task;
+    }
+  }
+
+  for (std::unique_ptr<Worker> &victim : workers) {
+    if (victim.get() == self)
+      continue;
+
+    std::lock_guard<std::mutex> lock(victim->mutex);
+    if (!victim->tasks.empty()) {
+      EvalTask *task = victim->tasks.front();
+      victim->tasks.pop_front();
+      --queued;
+      ++evalStats.tasksStolen;
+      return task;
+    }
+  }
+
+  return nullptr;
+}
+
+bool ThreadPool::take(Worker *self, EvalTask *task) noexcept {
+  std::lock_guard<std::mutex> lock(self->mutex);
+  for (auto it = self->tasks.rbegin(); it != self->tasks.rend(); ++it) {
+    if (*it == task) {
+      self->tasks.erase(std::next(it).base());
+      --queued;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::spawn(Worker *self, EvalTask *task) noexcept {
+  ++evalStats.tasksSpawned;
+  self->outstanding.push_back(task);
+  {
+    std::lock_guard<std::mutex> lock(self->mutex);
+    self->tasks.push_back(task);
+  }
+  {
+    // Waiting workers check queued with idleMutex locked
+    std::lock_guard<std::mutex> lock(idleMutex);
+    ++queued;
+  }
+  idleCV.notify_one();
+}
+
+void ThreadPool::run(EvalTask *task) noexcept {
+  const EvalTask *oldTask = currentTask;
+  EvalContext *oldContext = currentEvalContext();
+  currentTask = task;
+  // Own context, so thunks forced by the interrupted evaluation aren't
+  // considered forced by the task
+  EvalContext context{{}, std::this_thread::get_id()};
+  currentEvalContext() = &context;
+
+  // Own environment, so the roots of this thread are separated
+  Environment *taskEnv = new Environment(gc, task->env->lexer, task->env);
+  taskEnv->setBudget(task->budget);
+  task->result = ::evalValue(gc, *taskEnv, task->expr);
+
+  currentTask = oldTask;
+  currentEvalContext() = oldContext;
+  flushReductionSteps();
+  GCMain::flushCountAllocated();
+  flushEvalStats();
+
+  task->done.store(true, std::memory_order_release);
+  notify();
+}
+
+void ThreadPool::join(Environment &env, EvalTask &task) noexcept {
+  waitUntil(env, [&task] { return task.done.load(std::memory_order_acquire); });
+}
+
+void ThreadPool::waitUntil(Environment &env,
+    const std::function<bool()> &done) noexcept {
+  Worker *self = static_cast<Worker*>(currentWorker);
+  while (!done()) {
+    // Help other workers while waiting
+    if (EvalTask *other = steal(self)) {
+      self->envs.push_back(&env); // env isn't in the environment of other
+      run(other);
+      self->envs.pop_back();
+      continue;
+    }
+
+    leave(self, &env);
+    {
+      std::unique_lock<std::mutex> lock(idleMutex);
+      ++idle;
+      idleCV.wait(lock, [this, &done] {
+            return done() || queued.load() > 0;
+          });
+      --idle;
+    }
+    enter(self, &env);
+  }
+}
+
+void ThreadPool::notify() noexcept {
+  {
+    // A waiting worker is either still checking its condition (and sees the
+    // change) or already waits for the notification
+    std::lock_guard<std::mutex> lock(idleMutex);
+  }
+  idleCV.notify_all();
+}
+
+void ThreadPool::markRoots() noexcept {
+  {
+    std::lock_guard<std::mutex> lock(futuresMutex);
+    futures.remove_if([](FutureExpr *future) { return future->isDone(); });
+    for (FutureExpr *future : futures)
+      future->mark(gc);
+  }
+
+  for (std::unique_ptr<Worker> &worker : workers) {
+    for (Environment *env : worker->envs)
+      env->mark(gc);
+
+    for (EvalTask *task : worker->outstanding) {
+      task->expr->mark(gc);
+      task->env->mark(gc);
+      if (task->result.getExpr()) task->result.getExpr()->mark(gc);
+    }
+  }
+}
+
+//!\return Returns true if expr applies a function, which isn't a builtin.
+static bool isCall(const Expr *expr) noexcept {
+  if (expr->hasLastEval())
+    return false; // already evaluated
+
+  if (expr->getExpressionType() == expr_thunk) {
+    const ThunkExpr *thunk = dynamic_cast<const ThunkExpr*>(expr);
+    return !thunk->isEvaluated() && isCall(&thunk->getExpression());
+  }
+
+  const Expr *fn = expr;
+  while (fn->getExpressionType() == expr_biop
+      && dynamic_cast<const BiOpExpr*>(fn)->getOperator() == op_fn)
+    fn = &dynamic_cast<const BiOpExpr*>(fn)->getLHS();
+
+  if (fn == expr)
+    return false; // no application
+
+  switch (fn->getExpressionType()) {
+  case expr_id:
+  case expr_fn:
+  case expr_lambda:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool ThreadPool::hasIdleWorkers() const noexcept {
+  // A fixed spawn depth either creates tasks nobody steals (each costs a
+  // lock and a notification) or too few to balance the load. The size of
+  // an operand isn't known before evaluating it, so tasks are created if a
+  // worker would take them.
+  return idle.load(std::memory_order_relaxed)
+    > queued.load(std::memory_order_relaxed);
+}
+
+bool ThreadPool::shouldSpawn(const Expr *lhs, const Expr *rhs) const noexcept {
+  return workers.size() > 1 && currentWorker && hasIdleWorkers()
+    && isCall(lhs) && isCall(rhs);
+}
+
+void ThreadPool::evalBoth(GCMain &gc, Environment &env, Expr *lhs, Expr *rhs,
+    Value &lhsval, Value &rhsval) noexcept {
+
+  Worker *self = static_cast<Worker*>(currentWorker);
+
+  EvalTask task;
+  task.expr = rhs;
+  task.env = &env;
+  task.budget = env.getBudget();
+  task.parent = currentTask;
+  task.speculative = isSpeculative();
+  spawn(self, &task);
+
+  lhsval = ::evalValue(gc, env, lhs);
+  StackFrameObj<Expr> lhsObj(env, lhsval.getExpr());
+
+  if (take(self, &task)) {
+    // Nobody was idle: evaluate sequentially
+    if (lhsval)
+      task.result = ::evalValue(gc, env, rhs);
+  } else
+    join(env, task);
+
+  self->outstanding.pop_back();
+
+  rhsval = task.result;
+}
+
+//!\return Returns true if expr contains an unevaluated function application.
+static bool containsCall(const Expr *expr) noexcept {
+  if (isCall(expr))
+    return true;
+
+  switch (expr->getExpressionType()) {
+  case expr_biop: {
+      const BiOpExpr *biop = dynamic_cast<const BiOpExpr*>(expr);
+      return biop->getOperator() != op_fn
+        && (containsCall(&biop->getLHS()) || containsCall(&biop->getRHS()));
+    }
+  case expr_unop:
+    return containsCall(
+        &dynamic_cast<const UnOpExpr*>(expr)->getExpression());
+  default:
+    return false;
+  }
+}
+
+bool ThreadPool::shouldSpeculate(
+    const std::vector<Expr*> &conditions) const noexcept {
+  if (workers.size() < 2 || !currentWorker || !hasIdleWorkers())
+    return false;
+
+  for (std::size_t i = 1; i < conditions.size(); ++i)
+    if (containsCall(conditions[i]))
+      return true;
+
+  return false;
+}
+
+std::size_t ThreadPool::evalFirst(GCMain &gc, Environment &env,
+    const std::vector<Expr*> &conditions, Value &result) noexcept {
+
+  Worker *self = static_cast<Worker*>(currentWorker);
+
+  // Every condition except the first one is a task
+  std::vector<std::unique_ptr<EvalTask>> tasks;
+  for (std::size_t i = 1; i < conditions.size(); ++i) {
+    tasks.emplace_back(new EvalTask());
+    tasks.back()->expr = conditions[i];
+    tasks.back()->env = &env;
+    tasks.back()->budget = env.getBudget();
+    tasks.back()->parent = currentTask;
+    tasks.back()->speculative = true;
+  }
+
+  // Lowest priority first, so the owner takes the next condition from the
+  // back and thieves steal the last conditions
+  for (auto it = tasks.rbegin(); it != tasks.rend(); ++it)
+    spawn(self, it->get());
+
+  std::size_t first = 0;
+  for (; first < conditions.size(); ++first) {
+    EvalTask *task = first > 0 ? tasks[first - 1].get() : nullptr;
+    if (!task || take(self, task))
+      result = ::evalValue(gc, env, conditions[first]);
+    else {
+      join(env, *task);
+      result = task->result;
+      if (!result) // report the error
+        result = ::evalValue(gc, env, conditions[first]);
+    }
+
+    if (!result || !result.isAtom() || result.isTrue())
+      break;
+  }
+
+  StackFrameObj<Expr> resultObj(env, result.getExpr());
+
+  // Cancel the unneeded conditions
+  for (std::size_t i = first; i < tasks.size(); ++i)
+    tasks[i]->cancelled = true;
+
+  for (std::size_t i = first; i < tasks.size(); ++i)
+    if (!take(self, tasks[i].get()))
+      join(env, *tasks[i]);
+
+  self->outstanding.resize(self->outstanding.size() - tasks.size());
+
+  return first;
+}
+
+void ThreadPool::submit(FutureExpr *future) noexcept {
+  Worker *self = static_cast<Worker*>(currentWorker);
+  {
+    std::lock_guard<std::mutex> lock(futuresMutex);
+    futures.push_back(future);
+  }
+  {
+    std::lock_guard<std::mutex> lock(self->mutex);
+    self->tasks.push_back(&future->getTask());
+  }
+  {
+    std::lock_guard<std::mutex> lock(idleMutex);
+    ++queued;
+  }
+  idleCV.notify_one();
+}
+
+Value ThreadPool::await(GCMain &gc, Environment &env,
+    FutureExpr *future) noexcept {
+  Worker *self = static_cast<Worker*>(currentWorker);
+  StackFrameObj<Expr> futureObj(env, future);
+
+  EvalTask &task = future->getTask();
+  if (take(self, &task)) {
+    self->envs.push_back(&env); // env isn't in the environment of task
+    run(&task);
+    self->envs.pop_back();
+  } else
+    join(env, task);
+
+  return task.result;
+}
+
+void ThreadPool::suspend(Environment &env) noexcept {
+  leave(static_cast<Worker*>(currentWorker), &env);
+}
+
+void ThreadPool::resume(Environment &env) noexcept {
+  enter(static_cast<Worker*>(currentWorker), &env);
+}
+
+void ThreadPool::safepoint(Environment &env, bool collect) noexcept {
+  if (!collect && !stopRequested.load(std::memory_order_relaxed))
+    return;
+
+  Worker *self = static_cast<Worker*>(currentWorker);
+
+  std::unique_lock<std::mutex> lock(gcMutex);
+  self->envs.push_back(&env);
+  --active;
+
+  if (stopRequested.load()) {
+    // Another worker collects
+    gcCV.notify_all();
+    gcCV.wait(lock, [this] { return !stopRequested.load(); });
+  } else {
+    stopRequested = true;
+    gcCV.wait(lock, [this] { return active == 0; });
+
+    drainSamples();
+    gc.beginMark();
+    markRoots();
+    gc.collect();
+
+    stopRequested = false;
+    gcCV.notify_all();
+  }
+
+  ++active;
+  self->envs.pop_back();
+}
+
+void gcSafepoint(GCMain &gc, Environment &env) noexcept {
+  // Over the heap cap: Collect before the evaluation is aborted
+  std::size_t countNewObjs = gc.getCountNewObjects();
+  bool collect = countNewObjs >= collectThreshold
+    || (countNewObjs > 0 && gc.exceedsLimit());
+  if (env.pool && currentWorker) {
+    env.pool->safepoint(env, collect);
+    return;
+  }
+
+  if (!collect)
+    return;
+
+  drainSamples();
+  gc.beginMark();
+  env.mark(gc);
+  gc.collect();
+}
+
+bool isCancelled() noexcept {
+  if (isInterrupted())
+    return true;
+
+  for (const EvalTask *task = currentTask; task; task = task->parent)
+    if (task->cancelled.load(std::memory_order_relaxed))
+      return true;
+
+  return false;
+}
+
+bool isSpeculative() noexcept {
+  for (const EvalTask *task = currentTask; task; task = task->parent)
+    if (task->speculative)
+      return true;
+
+  return false;
+}
+
+void collectGarbage(GCMain &gc, Environment &env) noexcept {
+  if (env.pool && currentWorker) {
+    env.pool->safepoint(env, true);
+    return;
+  }
+
+  drainSamples();
+  gc.beginMark();
+  env.mark(gc);
+  gc.collect();
+}
+
+// FutureExpr
+
+FutureExpr::FutureExpr(GCMain &gc, const TokenPos &pos, Expr *expr,
+    Environment &env) noexcept
+    : Expr(gc, expr_future, pos) {
+  depth = 1 + expr->getDepth();
+
+  task.expr = expr;
+  task.env = &env;
+  task.budget = env.getBudget();
+  task.parent = nullptr;
+}
+
+void FutureExpr::evaluate(GCMain &gc) noexcept {
+  Environment *env = new Environment(gc, task.env->lexer, task.env);
+  env->setBudget(task.budget);
+  StackFrameObj<Expr> thisObj(*env, this);
+
+  task.result = ::evalValue(gc, *env, task.expr);
+  task.done.store(true, std::memory_order_release);
+}
+
+void FutureExpr::mark(GCMain &gc) noexcept {
+  if (isMarked(gc))
+    return;
+
+  markSelf(gc);
+  markLastEval(gc);
+  task.expr->mark(gc);
+  task.env->mark(gc);
+  if (task.budget) task.budget->mark(gc);
+  if (task.result.getExpr()) task.result.getExpr()->mark(gc);
+}
+
+bool FutureExpr::equals(const Expr *expr, bool exact) const noexcept {
+  if (this == expr) return true;
+
+  return !exact && expr->getExpressionType() == expr_any;
+}
@@ -14,19 +14,31 @@ Expr *parse(GCMain &gc, Lexer &lexer, Environment &env, bool topLevel) {
   if (!primaryExpr)
     return nullptr; // error forwarding
 
+  Expr *expr = primaryExpr;
   switch(lexer.currentToken()) {
     case tok_err:
       return nullptr; // Error forwarding
     case tok_eol:
     case tok_eof:
-      return primaryExpr;
+      break;
+    default:
+      // 0 is least binding precedence
+      expr = parseRHS(gc, lexer, env, primaryExpr, 0);
+      if (!expr) return nullptr;
+
+      if (!topLevel || !env.optimizer)
+        expr = expr->optimize(gc);
   }
 
-  // 0 is least binding precedence
-  Expr *expr = parseRHS(gc, lexer, env, primaryExpr, 0);
-  if (!expr) return nullptr;
+  if (!topLevel)
+    return expr;
+
+  if (env.optimizer) {
+    expr = env.optimizer->run(gc, env, expr);
+    if (!expr) return nullptr; // error forwarding
+  }
 
-  return expr->optimize(gc);
+  return resolveBuiltins(gc, env, expr);
 }
 
 Expr *parseRHS(GCMain &gc, Lexer &lexer, Environment &env, Expr *plhs, int prec) {
@@ -0,0 +1,140 @@
+#include "func/profiler.hpp"
+
+//! Innermost frame of the thread
+static thread_local ProfileFrame *currentFrame = nullptr;
+//! Count of running applications by entry (of the thread)
+static thread_local std::map<Profiler::Entry*, std::size_t> activeEntries;
+//! Expression, which isn't profiled as application (ignoreApplication)
+static thread_local const Expr *ignoredExpr = nullptr;
+
+Profiler::Entry *Profiler::getEntry(const std::string &name) noexcept {
+  std::lock_guard<std::mutex> lock(mutex);
+  return &entries[name];
+}
+
+void Profiler::add(Entry *entry, const Entry &costs) noexcept {
+  std::lock_guard<std::mutex> lock(mutex);
+  entry->calls += costs.calls;
+  entry->steps += costs.steps;
+  entry->selfSteps += costs.selfSteps;
+  entry->allocations += costs.allocations;
+  entry->time += costs.time;
+}
+
+void Profiler::print(std::ostream &out) const {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::vector<const std::pair<const std::string, Entry>*> sorted;
+  for (const auto &entry : entries)
+    sorted.push_back(&entry);
+
+  typedef const std::pair<const std::string, Entry> *EntryPtr;
+  std::sort(sorted.begin(), sorted.end(), [](EntryPtr a, EntryPtr b) {
+      return a->second.time > b->second.time;
+    });
+
+  out << "Profile (inclusive steps, time and allocations):" << std::endl;
+  for (const auto *entry : sorted) {
+    out << "  " << entry->first << ": "
+      << entry->second.calls << " calls, "
+      << entry->second.steps << " steps ("
+      << entry->second.selfSteps << " self), "
+      << entry->second.time << " ms, "
+      << entry->second.allocations << " allocations" << std::endl;
+  }
+}
+
+std::string getApplicationName(const Expr *expr) noexcept {
+  if (expr->getExpressionType() != expr_biop
+      || dynamic_cast<const BiOpExpr*>(expr)->getOperator() != op_fn)
+    return "";
+
+  // Function of the application
+  const Expr *fn = expr;
+  while (fn->getExpressionType() == expr_biop
+      && dynamic_cast<const BiOpExpr*>(fn)->getOperator() == op_fn)
+    fn = &dynamic_cast<const BiOpExpr*>(fn)->getLHS();
+
+  while (fn->getExpressionType() == expr_thunk) {
+    const ThunkExpr *thunk = dynamic_cast<const ThunkExpr*>(fn);
+    if (!thunk->isEvaluated())
+      return "";
+
+    fn = &thunk->getExpression();
+  }
+
+  switch (fn->getExpressionType()) {
+  case expr_id:
+    return dynamic_cast<const IdExpr*>(fn)->getName();
+  case expr_fn:
+    return dynamic_cast<const FunctionExpr*>(fn)->getName();
+  case expr_lambda:
+    return "\\" + dynamic_cast<const LambdaExpr*>(fn)->getName()
+      + " (line " + std::to_string(fn->getTokenPos().getLineStart() + 1)
+      + ")";
+  default:
+    return ""; // builtins, atom constructors
+  }
+}
+
+void ProfileFrame::enter(Environment &env, const Expr *expr) noexcept {
+  if (expr == ignoredExpr) {
+    ignoredExpr = nullptr;
+    return;
+  }
+
+  name = getApplicationName(expr);
+  if (name.empty())
+    return;
+
+  active = true;
+  tracer = env.tracer;
+  pos = expr->getTokenPos();
+
+  profiler = env.profiler;
+  if (profiler) {
+    entry = profiler->getEntry(name);
+    outermost = activeEntries[entry]++ == 0;
+  }
+
+  parent = currentFrame;
+  currentFrame = this;
+
+  startSteps = getThreadReductionSteps();
+  startAllocations = GCMain::getCountAllocated();
+  startTime = std::chrono::steady_clock::now();
+}
+
+void ProfileFrame::leave() noexcept {
+  std::chrono::steady_clock::time_point endTime =
+    std::chrono::steady_clock::now();
+  std::size_t steps = getThreadReductionSteps() - startSteps;
+
+  if (tracer)
+    tracer->span(name, "eval", startTime, endTime, &pos);
+
+  if (profiler) {
+    Profiler::Entry costs;
+    costs.calls = 1;
+    costs.selfSteps = steps - childSteps;
+    if (outermost) {
+      costs.steps = steps;
+      costs.allocations = GCMain::getCountAllocated() - startAllocations;
+      costs.time = std::chrono::duration<double, std::milli>(
+          endTime - startTime).count();
+    }
+
+    profiler->add(entry, costs);
+
+    if (--activeEntries[entry] == 0)
+      activeEntries.erase(entry);
+  }
+
+  currentFrame = parent;
+  if (parent)
+    parent->childSteps += steps;
+}
+
+void ignoreApplication(const Expr *expr) noexcept {
+  ignoredExpr = expr;
+}
@@ -0,0 +1,93 @@
+#include "func/resumable.hpp"
+
+#include <sys/mman.h>
+
+//! Evaluation running on the current thread (nullptr if none)
+static thread_local Evaluation *currentEvaluation = nullptr;
+
+Evaluation::Evaluation(GCMain &gc, Environment &parent, Expr *expr,
+    std::size_t stackSize)
+    : gc(gc), expr{expr}, stackSize{stackSize} {
+
+  env = new Environment(gc, parent.lexer, &parent);
+  env->pool = nullptr; // coroutines would break the fork-join order
+  env->profiler = nullptr; // and the nesting of the profiled applications
+  env->tracer = nullptr;
+  env->ctx.push_back(expr);
+  root = env;
+  gc.addRoot(&root);
+
+  // Only reserved, the lowest page guards against stack overflows
+  void *memory = mmap(nullptr, stackSize, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+  stack = memory == MAP_FAILED ? nullptr : static_cast<char*>(memory);
+  if (stack)
+    mprotect(stack, 4096, PROT_NONE);
+}
+
+Evaluation::~Evaluation() {
+  gc.removeRoot(&root);
+  if (stack)
+    munmap(stack, stackSize);
+}
+
+void Evaluation::entry() noexcept {
+  Evaluation *self = currentEvaluation;
+  self->result = ::eval(self->gc, *self->env, self->expr);
+  self->root = self->result;
+  self->done = true;
+  // Returns to hostContext (uc_link)
+}
+
+bool Evaluation::resume(std::size_t steps) noexcept {
+  if (done)
+    return true;
+
+  if (!stack) {
+    // Failed allocating a stack: evaluate completely
+    result = ::eval(gc, *env, expr);
+    root = result;
+    done = true;
+    return true;
+  }
+
+  budget = steps;
+  resumeSteps = getReductionSteps();
+
+  outer = currentEvaluation;
+  currentEvaluation = this;
+  outerContext = currentEvalContext();
+  currentEvalContext() = &context;
+
+  if (!started) {
+    getcontext(&evalContext);
+    evalContext.uc_stack.ss_sp = stack;
+    evalContext.uc_stack.ss_size = stackSize;
+    evalContext.uc_link = &hostContext;
+    makecontext(&evalContext, &Evaluation::entry, 0);
+    started = true;
+  }
+
+  // The shadow stack is shared with the host: the frames of the evaluation
+  // are only on it while it runs
+  std::size_t hostDepth = getShadowDepth();
+  resumeShadowFrames(shadowFrames);
+  swapcontext(&hostContext, &evalContext);
+  suspendShadowFrames(hostDepth, shadowFrames);
+
+  currentEvalContext() = outerContext;
+  currentEvaluation = outer;
+  this->steps += getReductionSteps() - resumeSteps;
+
+  return done;
+}
+
+void yieldPoint(Environment &env) noexcept {
+  Evaluation *self = currentEvaluation;
+  if (!self || getReductionSteps() - self->resumeSteps < self->budget)
+    return;
+
+  self->root = &env; // the suspended evaluation is marked from here
+  swapcontext(&self->evalContext, &self->hostContext);
+  self->root = self->env;
+}
@@ -0,0 +1,177 @@
+#include "func/sampler.hpp"
+
+#include <sys/time.h>
+
+//! Shadow stack of the current thread (read by the signal handler)
+static thread_local struct {
+  std::size_t depth = 0;
+  SamplePos frames[Sampler::maxDepth];
+} shadowStack;
+
+//! Running sampler (used by the signal handler)
+static std::atomic<Sampler*> currentSampler{nullptr};
+
+const std::size_t Sampler::maxDepth;
+const std::size_t Sampler::capacity;
+std::atomic<bool> Sampler::active{false};
+
+static void handleSample(int) {
+  Sampler *sampler = currentSampler.load();
+  if (sampler)
+    sampler->record();
+}
+
+void pushShadowFrame(const TokenPos &pos) noexcept {
+  if (shadowStack.depth < Sampler::maxDepth) {
+    SamplePos &frame = shadowStack.frames[shadowStack.depth];
+    frame.line = pos.getLineStart();
+    frame.column = pos.getStart();
+  }
+
+  // The frame must be written before the signal handler can read it
+  std::atomic_signal_fence(std::memory_order_release);
+  ++shadowStack.depth;
+}
+
+void popShadowFrame() noexcept {
+  --shadowStack.depth;
+}
+
+std::size_t getShadowDepth() noexcept {
+  return shadowStack.depth;
+}
+
+void suspendShadowFrames(std::size_t depth, ShadowFrames &frames) noexcept {
+  frames.depth = shadowStack.depth - depth;
+  frames.frames.clear();
+  std::size_t recorded = std::min(shadowStack.depth, Sampler::maxDepth);
+  for (std::size_t i = depth; i < recorded; ++i)
+    frames.frames.push_back(shadowStack.frames[i]);
+
+  shadowStack.depth = depth;
+}
+
+void resumeShadowFrames(const ShadowFrames &frames) noexcept {
+  std::size_t depth = shadowStack.depth;
+  for (std::size_t i = 0; i < frames.depth && depth + i < Sampler::maxDepth; ++i)
+    shadowStack.frames[depth + i] = i < frames.frames.size()
+      ? frames.frames[i] : SamplePos{0, 0};
+
+  // The frames must be written before the signal handler can read them
+  std::atomic_signal_fence(std::memory_order_release);
+  shadowStack.depth = depth + frames.depth;
+}
+
+Sampler::Sampler(long interval) : ring(new Sample[capacity]) {
+  currentSampler = this;
+  active = true;
+
+  struct sigaction action = {};
+  action.sa_handler = handleSample;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGPROF, &action, nullptr);
+
+  struct itimerval timer = {};
+  timer.it_interval.tv_sec = interval / 1000000;
+  timer.it_interval.tv_usec = interval % 1000000;
+  timer.it_value = timer.it_interval;
+  setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+Sampler::~Sampler() {
+  struct itimerval timer = {};
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  std::signal(SIGPROF, SIG_IGN);
+
+  active = false;
+  currentSampler = nullptr;
+}
+
+void Sampler::record() noexcept {
+  std::size_t index = head.load();
+  if (index - tail.load() >= capacity
+      || !head.compare_exchange_strong(index, index + 1)) {
+    ++dropped; // full or another thread records
+    return;
+  }
+
+  Sample &sample = ring[index % capacity];
+  std::atomic_signal_fence(std::memory_order_acquire);
+  sample.depth = shadowStack.depth;
+  std::size_t depth = std::min(sample.depth, maxDepth);
+  for (std::size_t i = 0; i < depth; ++i)
+    sample.frames[i] = shadowStack.frames[i];
+
+  sample.ready.store(true, std::memory_order_release);
+}
+
+void Sampler::drain() noexcept {
+  std::lock_guard<std::mutex> lock(drainMutex);
+  std::size_t index = tail.load();
+  for (; index != head.load(); ++index) {
+    Sample &sample = ring[index % capacity];
+    if (!sample.ready.load(std::memory_order_acquire))
+      break; // still written
+
+    std::vector<std::uint64_t> stack;
+    std::size_t depth = std::min(sample.depth, maxDepth);
+    for (std::size_t i = 0; i < depth; ++i)
+      stack.push_back((std::uint64_t) sample.frames[i].line << 32
+          | sample.frames[i].column);
+
+    if (sample.depth > maxDepth)
+      stack.push_back(UINT64_MAX); // cut off
+
+    ++stacks[stack];
+    sample.ready.store(false, std::memory_order_relaxed);
+  }
+
+  tail.store(index);
+}
+
+//!\return Returns label of the encoded position (text of the source line).
+static std::string frameLabel(std::uint64_t frame,
+    const std::vector<std::string> &lines) {
+  if (frame == UINT64_MAX)
+    return "...";
+
+  std::size_t line = frame >> 32;
+  std::size_t column = frame & 0xffffffff;
+
+  std::string text;
+  if (line < lines.size()) {
+    text = lines[line];
+    text.erase(0, text.find_first_not_of(" \t"));
+    if (text.size() > 40)
+      text = text.substr(0, 37) + "...";
+  }
+
+  // Separator of the folded format
+  std::replace(text.begin(), text.end(), ';', ',');
+
+  return std::to_string(line + 1) + ":" + std::to_string(column)
+    + " " + text;
+}
+
+void Sampler::write(std::ostream &out, const std::vector<std::string> &lines) {
+  drain();
+
+  std::lock_guard<std::mutex> lock(drainMutex);
+  for (const auto &entry : stacks) {
+    std::string folded = "interpreter";
+    for (std::uint64_t frame : entry.first)
+      folded += ";" + frameLabel(frame, lines);
+
+    out << folded << " " << entry.second << std::endl;
+  }
+
+  if (dropped.load() > 0)
+    out << "interpreter;[dropped] " << dropped.load() << std::endl;
+}
+
+void drainSamples() noexcept {
+  Sampler *sampler = currentSampler.load();
+  if (sampler)
+    sampler->drain();
+}
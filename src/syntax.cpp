@@ -1,4 +1,8 @@
 #include "func/syntax.hpp"
+#include "func/parallel.hpp"
+#include "func/profiler.hpp"
+#include "func/resumable.hpp"
+#include "func/sampler.hpp"
 
 std::vector<Expr*>::iterator find(std::vector<Expr*> &vec, Expr *expr) noexcept {
   for (auto it = vec.begin(); it != vec.end(); ++it)
@@ -9,14 +13,170 @@ std::vector<Expr*>::iterator find(std::vector<Expr*> &vec, Expr *expr) noexcept
 
 // Expr
 
+//! Names of the expression types (by ExprType)
+static const char *const exprTypeNames[] = {
+  "biop", "unop", "num", "int", "id", "lambda", "atom", "if", "any", "let",
+  "function", "thunk", "builtin", "future"
+};
+static_assert(
+    sizeof(exprTypeNames) / sizeof(exprTypeNames[0]) == expr_future + 1,
+    "Every ExprType needs a name");
+
+const char *getExprTypeName(ExprType type) noexcept {
+  return exprTypeNames[type];
+}
+
+//! Count of reduction steps of the current thread
+static thread_local std::size_t reductionSteps = 0;
+//! Part of reductionSteps added to totalReductionSteps
+static thread_local std::size_t flushedReductionSteps = 0;
+//! Flushed reduction steps of all threads
+static std::atomic<std::size_t> totalReductionSteps{0};
+
+std::size_t getReductionSteps() noexcept {
+  return totalReductionSteps.load(std::memory_order_relaxed)
+    + reductionSteps - flushedReductionSteps;
+}
+
+void flushReductionSteps() noexcept {
+  totalReductionSteps.fetch_add(reductionSteps - flushedReductionSteps,
+      std::memory_order_relaxed);
+  flushedReductionSteps = reductionSteps;
+}
+
+std::size_t getThreadReductionSteps() noexcept {
+  return reductionSteps;
+}
+
+//! Count of applied builtins with side effects (of all threads)
+static std::atomic<std::size_t> appliedEffects{0};
+
+void countEffect() noexcept {
+  appliedEffects.fetch_add(1, std::memory_order_relaxed);
+}
+
+thread_local EvalStats evalStats;
+
+//! Flushed counters of all threads
+static EvalStats totalEvalStats;
+static std::mutex totalEvalStatsMutex; //!< Guards totalEvalStats
+
+EvalStats &EvalStats::operator +=(const EvalStats &stats) noexcept {
+  reductionSteps += stats.reductionSteps;
+  cacheHits += stats.cacheHits;
+  cacheMisses += stats.cacheMisses;
+  replaceCopies += stats.replaceCopies;
+  equalsCalls += stats.equalsCalls;
+  equalsNodes += stats.equalsNodes;
+  equalsMaxDepth = std::max(equalsMaxDepth, stats.equalsMaxDepth);
+  lookups += stats.lookups;
+  lookupHops += stats.lookupHops;
+  framePushes += stats.framePushes;
+  framePops += stats.framePops;
+  tasksSpawned += stats.tasksSpawned;
+  tasksStolen += stats.tasksStolen;
+  for (int type = 0; type <= expr_future; ++type)
+    allocated[type] += stats.allocated[type];
+
+  return *this;
+}
+
+void EvalStats::print(std::ostream &out) const {
+  out << "Evaluator:" << std::endl
+    << "  reduction steps: " << reductionSteps << std::endl
+    << "  evaluation cache: " << cacheHits << " hits, "
+      << cacheMisses << " misses" << std::endl
+    << "  replace: " << replaceCopies << " nodes copied" << std::endl
+    << "  equals: " << equalsCalls << " calls, " << equalsNodes
+      << " nodes, depth " << equalsMaxDepth << std::endl
+    << "  lookups: " << lookups << " (" << lookupHops << " hops)" << std::endl
+    << "  stack frame: " << framePushes << " pushes, " << framePops
+      << " pops" << std::endl
+    << "  tasks: " << tasksSpawned << " spawned, " << tasksStolen
+      << " stolen" << std::endl
+    << "  allocated:";
+
+  std::size_t total = 0;
+  for (int type = 0; type <= expr_future; ++type)
+    total += allocated[type];
+  out << " " << total << " expressions" << std::endl;
+
+  for (int type = 0; type <= expr_future; ++type)
+    if (allocated[type] > 0)
+      out << "    " << getExprTypeName(ExprType(type)) << ": "
+        << allocated[type] << std::endl;
+}
+
+void flushEvalStats() noexcept {
+  std::lock_guard<std::mutex> lock(totalEvalStatsMutex);
+  totalEvalStats += evalStats;
+  evalStats = EvalStats();
+}
+
+EvalStats getEvalStats() noexcept {
+  EvalStats stats;
+  {
+    std::lock_guard<std::mutex> lock(totalEvalStatsMutex);
+    stats = totalEvalStats;
+  }
+
+  stats += evalStats;
+  stats.reductionSteps = getReductionSteps();
+  return stats;
+}
+
+//! Count of running top level evaluations (see beginInterruptible)
+static std::atomic<std::size_t> interruptibleEvaluations{0};
+//! Set by interruptEvaluation (lock-free, so usable in signal handlers)
+static std::atomic<bool> interruptRequested{false};
+
+bool interruptEvaluation() noexcept {
+  if (interruptibleEvaluations.load() == 0)
+    return false;
+
+  interruptRequested.store(true);
+  return true;
+}
+
+bool isInterrupted() noexcept {
+  return interruptRequested.load(std::memory_order_relaxed);
+}
+
+void beginInterruptible() noexcept {
+  ++interruptibleEvaluations;
+}
+
+bool endInterruptible() noexcept {
+  bool interrupted = interruptRequested.load();
+  if (--interruptibleEvaluations == 0)
+    interruptRequested.store(false);
+
+  return interrupted;
+}
+
 Expr *Expr::evalWithLookup(GCMain &gc, Environment &env) noexcept {
   StackFrameObj<Expr> thisObj(env, this);
 
-  if (lastEval  && (getExpressionType() != expr_biop
-          || dynamic_cast<const BiOpExpr*>(this)->getOperator() != op_asg))
-    return lastEval;
+  // Forcing a thunk is no reduction step (only the reductions of the
+  // delayed expression are)
+  if (getExpressionType() != expr_thunk)
+    ++reductionSteps;
 
-  return lastEval = eval(gc, env);
+  Expr *result = lastEval.load(std::memory_order_acquire);
+  if (result && (getExpressionType() != expr_biop
+          || dynamic_cast<const BiOpExpr*>(this)->getOperator() != op_asg)) {
+    ++evalStats.cacheHits;
+    return result;
+  }
+
+  ++evalStats.cacheMisses;
+  std::size_t effects = appliedEffects.load(std::memory_order_relaxed);
+  result = eval(gc, env);
+  // Nodes of function bodies are shared by all applications: don't cache
+  // evaluations with side effects (e.g. print), so they happen every time
+  if (appliedEffects.load(std::memory_order_relaxed) == effects)
+    lastEval.store(result, std::memory_order_release);
+  return result;
 }
 
 // FunctionExpr
@@ -44,6 +204,7 @@ bool FunctionExpr::addCase(std::pair<std::vector<Expr*>, Expr*> fncase) noexcept
 
   // Reset evaluation
   lastEval = nullptr;
+  specializations.clear();
 
   fncases.push_back(std::move(fncase));
 
@@ -53,6 +214,20 @@ bool FunctionExpr::addCase(std::pair<std::vector<Expr*>, Expr*> fncase) noexcept
   return true;
 }
 
+const FunctionExpr::Specialization *FunctionExpr::getSpecialization(
+    const std::string &key) const noexcept {
+  auto it = specializations.find(key);
+  if (it == specializations.end())
+    return nullptr;
+
+  return &it->second;
+}
+
+void FunctionExpr::addSpecialization(const std::string &key,
+    Specialization spec) noexcept {
+  specializations[key] = std::move(spec);
+}
+
 // Environment
 
 bool Environment::contains(const std::string &name) const noexcept {
@@ -63,12 +238,17 @@ bool Environment::contains(const std::string &name) const noexcept {
 }
 
 const Expr *Environment::get(const std::string &name) const noexcept {
-  auto it = variables.find(name);
-  if (it != variables.end()) {
-    return it->second;
+  ++evalStats.lookups;
+  for (const Environment *env = this; env; env = env->parent) {
+    auto it = env->variables.find(name);
+    if (it != env->variables.end()) {
+      return it->second;
+    }
+
+    ++evalStats.lookupHops;
   }
 
-  return parent ? parent->get(name) : nullptr;
+  return nullptr;
 }
 
 const Expr *Environment::currentGet(const std::string &name) const noexcept {
@@ -91,9 +271,87 @@ void Environment::mark(GCMain &gc) noexcept {
   for (Expr *expr : ctx)
     expr->mark(gc);
 
+  if (EvalBudget *budget = getBudget()) budget->mark(gc);
   if (parent) parent->mark(gc);
 }
 
+// EvalBudget
+
+EvalBudget::EvalBudget(GCMain &gc, const EvalLimits &limits) noexcept
+    : GCObj(gc), gc(gc), limits(limits), startSteps{getReductionSteps()},
+      deadline{std::chrono::steady_clock::now()
+        + std::chrono::microseconds((int64_t) (limits.timeout * 1000))} {}
+
+bool EvalBudget::check(Lexer &lexer, const TokenPos &pos) noexcept {
+  // Reading the clock is expensive, so the deadline is checked only
+  // every 256 calls (of a thread)
+  static thread_local unsigned clockCountdown = 0;
+
+  if (exceeded.load(std::memory_order_relaxed))
+    return false;
+
+  std::string msg;
+  std::size_t steps = getReductionSteps();
+  if (limits.maxSteps > 0 && steps > startSteps
+      && steps - startSteps > limits.maxSteps)
+    msg = "Evaluation exceeded " + std::to_string(limits.maxSteps)
+      + " reduction steps.";
+  else if (gc.exceedsLimit()) // checked after collecting (gcSafepoint)
+    msg = "Evaluation exceeded the heap limit of "
+      + std::to_string(gc.getMaxObjects()) + " objects.";
+  else if (limits.timeout > 0 && clockCountdown-- == 0) {
+    clockCountdown = 255;
+    if (std::chrono::steady_clock::now() > deadline) {
+      std::ostringstream stream;
+      stream << "Evaluation exceeded the timeout of " << limits.timeout
+        << " ms.";
+      msg = stream.str();
+    }
+  }
+
+  if (msg.empty())
+    return true;
+
+  if (isSpeculative())
+    return false; // Maybe the result isn't needed
+
+  if (!exceeded.exchange(true))
+    reportSyntaxError(lexer, msg, pos);
+
+  return false;
+}
+
+// heap dump
+
+std::string Expr::getTypeName() const noexcept {
+  return getExprTypeName(type);
+}
+
+std::size_t Expr::getSize() const noexcept {
+  switch (type) {
+  case expr_biop: return sizeof(BiOpExpr);
+  case expr_unop: return sizeof(UnOpExpr);
+  case expr_num: return sizeof(NumExpr);
+  case expr_int: return sizeof(IntExpr);
+  case expr_id: return sizeof(IdExpr);
+  case expr_lambda: return sizeof(LambdaExpr);
+  case expr_atom: return sizeof(AtomExpr);
+  case expr_if: return sizeof(IfExpr);
+  case expr_any: return sizeof(AnyExpr);
+  case expr_let: return sizeof(LetExpr);
+  case expr_fn: return sizeof(FunctionExpr);
+  case expr_thunk: return sizeof(ThunkExpr);
+  case expr_builtin: return sizeof(BuiltinExpr);
+  case expr_future: return sizeof(FutureExpr);
+  }
+
+  return sizeof(Expr);
+}
+
+std::string Expr::getSite() const noexcept {
+  return "line " + std::to_string(pos.getLineStart() + 1);
+}
+
 // mark
 
 void Expr::mark(GCMain &gc) noexcept {
@@ -101,14 +359,14 @@ void Expr::mark(GCMain &gc) noexcept {
     return;
 
   markSelf(gc);
-  if (lastEval) lastEval->mark(gc);
+  markLastEval(gc);
 }
 
 void UnOpExpr::mark(GCMain &gc) noexcept {
   if (isMarked(gc)) return;
 
   markSelf(gc);
-  if (lastEval) lastEval->mark(gc);
+  markLastEval(gc);
 
   expr->mark(gc);
 }
@@ -118,7 +376,7 @@ void FunctionExpr::mark(GCMain &gc) noexcept {
     return;
 
   markSelf(gc);
-  if (lastEval) lastEval->mark(gc);
+  markLastEval(gc);
 
   for (const std::pair<std::vector<Expr*>, Expr*> &fncase : fncases) {
     for (Expr *expr : fncase.first) {
@@ -127,6 +385,9 @@ void FunctionExpr::mark(GCMain &gc) noexcept {
 
     fncase.second->mark(gc);
   }
+
+  for (auto &p : specializations)
+    if (p.second.body) p.second.body->mark(gc);
 }
 
 // BiOpExpr
@@ -169,6 +430,16 @@ const AtomExpr *BiOpExpr::getAtomConstructor() const noexcept {
 // Expressions
 
 Expr *reportSyntaxError(Lexer &lexer, const std::string &msg, const TokenPos &pos) {
+  if (isSpeculative())
+    return nullptr; // reported again, if the result is needed
+
+  if (isInterrupted())
+    return nullptr; // failed because of the interrupt
+
+  // Errors may be reported by several workers at once
+  static std::mutex reportMutex;
+  std::lock_guard<std::mutex> lock(reportMutex);
+
   lexer.skipNewLine = false; // reset new line skip
   lexer.reportError(msg, pos);
   return nullptr;
@@ -177,6 +448,8 @@ Expr *reportSyntaxError(Lexer &lexer, const std::string &msg, const TokenPos &po
 // evaluate
 
 Expr *eval(GCMain &gc, Environment &env, Expr *pexpr) noexcept {
+  ProfileFrame frame(env, pexpr);
+  ShadowFrame shadowFrame(pexpr);
 
   StackFrameObj<Expr> expr(env, pexpr);
   StackFrameObj<Expr> oldExpr(env, pexpr);
@@ -192,16 +465,51 @@ Expr *eval(GCMain &gc, Environment &env, Expr *pexpr) noexcept {
 
     oldExpr = expr;
 
-    if (gc.getCountNewObjects() < 200)
-      continue;
+    gcSafepoint(gc, env);
+    if (isCancelled())
+      return nullptr;
 
-    env.mark(gc);
-    gc.collect();
+    EvalBudget *budget = env.getBudget();
+    if (budget && expr && !budget->check(*env.lexer, expr->getTokenPos()))
+      return nullptr;
+
+    yieldPoint(env);
   }
 
   return *expr;
 }
 
+Value evalValue(GCMain &gc, Environment &env, Expr *expr) noexcept {
+  switch (expr->getExpressionType()) {
+  case expr_int:
+  case expr_num:
+    return Value::unbox(expr);
+  case expr_biop: {
+      BiOpExpr *biop = dynamic_cast<BiOpExpr*>(expr);
+      if (biop->getOperator() != op_asg && biop->getOperator() != op_fn) {
+        // Unboxed reductions bypass evalWithLookup, but are reduction steps
+        // all the same
+        ++reductionSteps;
+        return biop->evalValue(gc, env);
+      }
+
+      break;
+    }
+  case expr_unop:
+    ++reductionSteps;
+    return dynamic_cast<UnOpExpr*>(expr)->evalValue(gc, env);
+  case expr_thunk: {
+      ThunkExpr *thunk = dynamic_cast<ThunkExpr*>(expr);
+      if (thunk->isEvaluated())
+        return evalValue(gc, env, const_cast<Expr*>(&thunk->getExpression()));
+
+      break;
+    }
+  }
+
+  return Value::unbox(eval(gc, env, expr));
+}
+
 void breadthEval(GCMain &gc, Environment &env,
     StackFrameObj<Expr> &lhs, StackFrameObj<Expr> &rhs) noexcept {
   StackFrameObj<Expr> oldlhs(env, *lhs);
@@ -214,10 +522,18 @@ void breadthEval(GCMain &gc, Environment &env,
     oldlhs = lhs;
     oldrhs = rhs;
 
-    if (gc.getCountNewObjects() < 200)
-      continue;
+    gcSafepoint(gc, env);
+    if (isCancelled()) {
+      lhs = nullptr;
+      return;
+    }
+
+    EvalBudget *budget = env.getBudget();
+    if (budget && lhs && !budget->check(*env.lexer, lhs->getTokenPos())) {
+      lhs = nullptr;
+      return;
+    }
 
-    env.mark(gc);
-    gc.collect();
+    yieldPoint(env);
   }
 }
@@ -2,7 +2,26 @@
 
 // equals
 
+/*!\brief Counts a compared node (and the nesting) in evalStats while alive.
+ */
+class EqualsVisit {
+  static thread_local std::size_t depth;
+public:
+  EqualsVisit() noexcept {
+    ++evalStats.equalsNodes;
+    if (++depth == 1)
+      ++evalStats.equalsCalls;
+    if (depth > evalStats.equalsMaxDepth)
+      evalStats.equalsMaxDepth = depth;
+  }
+
+  ~EqualsVisit() { --depth; }
+};
+
+thread_local std::size_t EqualsVisit::depth = 0;
+
 bool BiOpExpr::equals(const Expr *expr, bool exact) const noexcept {
+  EqualsVisit visit;
   if (this == expr) return true;
   if (exact && getDepth() != expr->getDepth()) return false;
 
@@ -16,6 +35,7 @@ bool BiOpExpr::equals(const Expr *expr, bool exact) const noexcept {
 }
 
 bool IdExpr::equals(const Expr *expr, bool exact) const noexcept {
+  EqualsVisit visit;
   if (this == expr) return true;
   if (exact && getDepth() != expr->getDepth()) return false;
 
@@ -26,6 +46,7 @@ bool IdExpr::equals(const Expr *expr, bool exact) const noexcept {
 }
 
 bool LambdaExpr::equals(const Expr *expr, bool exact) const noexcept {
+  EqualsVisit visit;
   if (this == expr) return true;
   if (exact && getDepth() != expr->getDepth()) return false;
 
@@ -38,6 +59,7 @@ bool LambdaExpr::equals(const Expr *expr, bool exact) const noexcept {
 }
 
 bool AtomExpr::equals(const Expr *expr, bool exact) const noexcept {
+  EqualsVisit visit;
   if (this == expr) return true;
   if (exact && getDepth() != expr->getDepth()) return false;
 
@@ -48,10 +70,12 @@ bool AtomExpr::equals(const Expr *expr, bool exact) const noexcept {
 }
 
 bool AnyExpr::equals(const Expr *expr, bool exact) const noexcept {
+  EqualsVisit visit;
   return !exact || expr->getExpressionType() == expr_any;
 }
 
 bool LetExpr::equals(const Expr *expr, bool exact) const noexcept {
+  EqualsVisit visit;
   if (this == expr) return true;
   if (exact && getDepth() != expr->getDepth()) return false;
 
@@ -78,6 +102,7 @@ bool LetExpr::equals(const Expr *expr, bool exact) const noexcept {
 }
 
 bool IfExpr::equals(const Expr *expr, bool exact) const noexcept {
+  EqualsVisit visit;
   if (this == expr) return true;
   if (exact && getDepth() != expr->getDepth()) return false;
 
@@ -93,10 +118,12 @@ bool IfExpr::equals(const Expr *expr, bool exact) const noexcept {
 }
 
 bool NumExpr::equals(const Expr *expr, bool exact) const noexcept {
+  EqualsVisit visit;
   if (this == expr) return true;
   if (!exact && expr->getExpressionType() == expr_any) return true;
 
-  if (expr->getExpressionType() == expr_int)
+  // Exact: Different number types aren't equal (e.g. sharing 2 and 1.5)
+  if (!exact && expr->getExpressionType() == expr_int)
     return dynamic_cast<const IntExpr*>(expr)->getNumber() == round(getNumber());
 
   if (expr->getExpressionType() == expr_num)
@@ -106,10 +133,11 @@ bool NumExpr::equals(const Expr *expr, bool exact) const noexcept {
 }
 
 bool IntExpr::equals(const Expr *expr, bool exact) const noexcept {
+  EqualsVisit visit;
   if (this == expr) return true;
   if (!exact && expr->getExpressionType() == expr_any) return true;
 
-  if (expr->getExpressionType() == expr_num)
+  if (!exact && expr->getExpressionType() == expr_num)
     return round(dynamic_cast<const NumExpr*>(expr)->getNumber()) == getNumber();
 
   if (expr->getExpressionType() == expr_int)
@@ -119,6 +147,7 @@ bool IntExpr::equals(const Expr *expr, bool exact) const noexcept {
 }
 
 bool UnOpExpr::equals(const Expr *expr, bool exact) const noexcept {
+  EqualsVisit visit;
   if (this == expr) return true;
   if (exact && getDepth() != expr->getDepth()) return false;
 
@@ -130,3 +159,22 @@ bool UnOpExpr::equals(const Expr *expr, bool exact) const noexcept {
   return op == unopexpr->getOperator()
     && unopexpr->getExpression().equals(expr, exact);
 }
+
+bool ThunkExpr::equals(const Expr *expr, bool exact) const noexcept {
+  EqualsVisit visit;
+  if (this == expr) return true;
+
+  return getExpression().equals(expr, exact);
+}
+
+bool BuiltinExpr::equals(const Expr *expr, bool exact) const noexcept {
+  EqualsVisit visit;
+  if (this == expr) return true;
+  if (!exact && expr->getExpressionType() == expr_any) return true;
+
+  // Partially applied natives are only equal to themselves
+  return expr->getExpressionType() == expr_builtin
+    && &dynamic_cast<const BuiltinExpr*>(expr)->getBuiltin() == builtin
+    && args.empty()
+    && dynamic_cast<const BuiltinExpr*>(expr)->getArguments().empty();
+}
@@ -1,4 +1,7 @@
 #include "func/syntax.hpp"
+#include "func/builtin.hpp"
+#include "func/parallel.hpp"
+#include "func/profiler.hpp"
 
 // interpreter stuff
 
@@ -41,8 +44,8 @@ const Expr *assignAtomExpressions(GCMain &gc, Environment &env,
           "Must be an atom.", exprlhs->getTokenPos());
     }
     // check if atom names are equal
-    auto atomlhs = dynamic_cast<const AtomExpr&>(bioplhs->getLHS());
-    auto atomrhs = dynamic_cast<const AtomExpr&>(bioprhs->getLHS());
+    const auto &atomlhs = dynamic_cast<const AtomExpr&>(bioplhs->getLHS());
+    const auto &atomrhs = dynamic_cast<const AtomExpr&>(bioprhs->getLHS());
     if (atomlhs.getName() != atomrhs.getName()) {
       reportSyntaxError(*env.lexer,
           "", atomlhs.getTokenPos());
@@ -132,97 +135,70 @@ const Expr *assignExpressions(GCMain &gc, Environment &env,
       lhs->getTokenPos());
 }
 
-static Expr *biopeval(GCMain &gc, Environment &env,
-    const TokenPos &mergedPos, Operator op,
-    const NumExpr *lhs, const NumExpr *rhs) noexcept {
-  double num0 = lhs->getNumber();
-  double num1 = rhs->getNumber();
+static Value biopeval(Operator op, double num0, double num1) noexcept {
   switch (op) {
   case op_add: num0 += num1; break;
   case op_sub: num0 -= num1; break;
   case op_mul: num0 *= num1; break;
   case op_div: num0 /= num1; break;
   case op_pow: num0 = pow(num0, num1); break;
-  case op_leq: return new AtomExpr(gc, mergedPos, boolToAtom(num0 <= num1));
-  case op_geq: return new AtomExpr(gc, mergedPos, boolToAtom(num0 >= num1));
-  case op_le: return new AtomExpr(gc, mergedPos, boolToAtom(num0 < num1));
-  case op_gt: return new AtomExpr(gc, mergedPos, boolToAtom(num0 > num1));
+  case op_leq: return Value::fromBool(num0 <= num1);
+  case op_geq: return Value::fromBool(num0 >= num1);
+  case op_le: return Value::fromBool(num0 < num1);
+  case op_gt: return Value::fromBool(num0 > num1);
   }
-  return new NumExpr(gc, mergedPos, num0);
+  return Value::fromNum(num0);
 }
 
-static Expr *biopeval(GCMain &gc, Environment &env,
-    const TokenPos &mergedPos, Operator op,
-    const IntExpr *lhs, const IntExpr *rhs) noexcept {
-  std::int64_t num0 = lhs->getNumber();
-  std::int64_t num1 = rhs->getNumber();
+static Value biopeval(Operator op, std::int64_t num0, std::int64_t num1) noexcept {
   switch (op) {
   case op_add: num0 += num1; break;
   case op_sub: num0 -= num1; break;
   case op_mul: num0 *= num1; break;
   case op_div: num0 /= num1; break;
   case op_pow: num0 = pow(num0, num1); break;
-  case op_leq: return new AtomExpr(gc, mergedPos, boolToAtom(num0 <= num1));
-  case op_geq: return new AtomExpr(gc, mergedPos, boolToAtom(num0 >= num1));
-  case op_le: return new AtomExpr(gc, mergedPos, boolToAtom(num0 < num1));
-  case op_gt: return new AtomExpr(gc, mergedPos, boolToAtom(num0 > num1));
+  case op_leq: return Value::fromBool(num0 <= num1);
+  case op_geq: return Value::fromBool(num0 >= num1);
+  case op_le: return Value::fromBool(num0 < num1);
+  case op_gt: return Value::fromBool(num0 > num1);
   }
-  return new IntExpr(gc, mergedPos, num0);
+  return Value::fromInt(num0);
+}
+
+static bool valueEquals(GCMain &gc, const TokenPos &pos,
+    const Value &lhs, const Value &rhs) noexcept {
+  if (lhs.isInt() && rhs.isInt())
+    return lhs.getInt() == rhs.getInt();
+  if (lhs.isNum() && rhs.isNum())
+    return lhs.getNum() == rhs.getNum();
+  if (lhs.isInt() && rhs.isNum())
+    return lhs.getInt() == round(rhs.getNum());
+  if (lhs.isNum() && rhs.isInt())
+    return round(lhs.getNum()) == rhs.getInt();
+  if (lhs.isBool() && rhs.isBool())
+    return lhs.getBool() == rhs.getBool();
+
+  // Compare structures (box immediates)
+  return lhs.toExpr(gc, pos)->equals(rhs.toExpr(gc, pos), false);
 }
 
 Expr *evalLambdaSubstitution(GCMain &gc, Environment &env,
     const TokenPos &mergedPos, Expr* thisExpr,
     Expr *lhs, Expr *rhs) noexcept {
-  // special cases (built-in functions)
-  if (lhs->getExpressionType() == expr_id) {
-    const std::string &id = dynamic_cast<IdExpr*>(lhs)->getName();
-    if (id == "error") { // print error message
-      return reportSyntaxError(*env.lexer,
-          rhs->toString(),
-          mergedPos);
-    } else if (id == "print") { // print expression and return expr
-      std::cout << rhs->toString() << std::endl;
-      return rhs;
-    } else if (id == "to_int" || id == "round_int") { // truncate float to int
-      StackFrameObj<Expr> expr(env, ::eval(gc, env, rhs));
-      if (!expr) return nullptr; // error forwarding
-      switch (expr->getExpressionType()) {
-      case expr_int:
-        return *expr;
-      case expr_num:
-        if (id == "to_int")
-          return new IntExpr(gc, mergedPos,
-              (int64_t) floor(dynamic_cast<NumExpr*>(*expr)->getNumber()));
-        else if (id == "round_int")
-          return new IntExpr(gc, mergedPos,
-              (int64_t) round(dynamic_cast<NumExpr*>(*expr)->getNumber()));
-      }
-    } else if(id == "time") { // prints time spent evaluating RHS
-      auto startTime = std::chrono::high_resolution_clock::now();
-
-      StackFrameObj<Expr> expr(env, ::eval(gc, env, rhs));
-      if (!expr) return nullptr;
-
-      auto endTime = std::chrono::high_resolution_clock::now();
-      auto diffTime = endTime - startTime;
-      double consumedTime = diffTime.count() *
-        (double)std::chrono::high_resolution_clock::period::num /
-        (double)std::chrono::high_resolution_clock::period::den
-        * 1000; // seconds -> milliseconds
-
-      std::cout << "Needed "
-        << consumedTime
-        << " ms." << std::endl;
-
-      return *expr;
-    }
-  }
+  // Builtin functions (resolved while parsing)
+  if (lhs->getExpressionType() == expr_builtin)
+    return dynamic_cast<BuiltinExpr*>(lhs)->apply(gc, env, mergedPos, rhs);
 
   // Otherwise eval LHS.
 
+  // The function of a partial application is part of this application
+  if (env.profiler || env.tracer) ignoreApplication(lhs);
   StackFrameObj<Expr> newlhs(env, ::eval(gc, env, lhs));
   if (!newlhs) return nullptr; // Error forwarding
 
+  if (newlhs->getExpressionType() == expr_builtin)
+    return dynamic_cast<BuiltinExpr*>(*newlhs)->apply(gc, env, mergedPos, rhs);
+
   if (newlhs->getExpressionType() != expr_lambda) {
     // Evaluate rhs
     StackFrameObj<Expr> newrhs(env, ::eval(gc, env, rhs));
@@ -234,40 +210,59 @@ Expr *evalLambdaSubstitution(GCMain &gc, Environment &env,
       return new BiOpExpr(gc, mergedPos, op_fn, *newlhs, *newrhs);
   }
 
-  // Lambda calculus substitution
-  return dynamic_cast<LambdaExpr*>(*newlhs)->replace(gc, rhs);
+  LambdaExpr *lambda = dynamic_cast<LambdaExpr*>(*newlhs);
+
+  // Strict parameter: evaluate argument before substitution
+  StackFrameObj<Expr> newrhs(env, rhs);
+  if (lambda->isStrictParameter()) {
+    newrhs = ::eval(gc, env, rhs);
+    if (!newrhs) return nullptr; // error forwarding
+  }
+
+  // Lambda calculus substitution (call-by-need: delay the argument, so
+  // every occurrence in the body shares one evaluation)
+  if (!ThunkExpr::isValue(*newrhs))
+    newrhs = new ThunkExpr(gc, *newrhs);
+
+  return lambda->replace(gc, *newrhs);
 }
 
 Expr *BiOpExpr::eval(GCMain &gc, Environment &env) noexcept {
   StackFrameObj<BiOpExpr> thisObj(env, this);
-  TokenPos mergedPos = this->getTokenPos();
 
   switch (op) {
-  case op_asg: {
-      return const_cast<Expr*>(assignExpressions(gc, env, this, lhs, rhs));
-    }
+  case op_asg:
+    return const_cast<Expr*>(assignExpressions(gc, env, this, lhs, rhs));
+  case op_fn:
+    return evalLambdaSubstitution(gc, env, getTokenPos(),
+        this, lhs, rhs);
+  }
+
+  // Only the result is boxed
+  return evalValue(gc, env).toExpr(gc, getTokenPos());
+}
+
+Value BiOpExpr::evalValue(GCMain &gc, Environment &env) noexcept {
+  StackFrameObj<BiOpExpr> thisObj(env, this);
+
+  switch (op) {
   case op_land:
   case op_lor: {
        // Lazy evaluation
-       StackFrameObj<Expr> newlhs(env, ::eval(gc, env, lhs));
-       if (!newlhs) return nullptr; // error forwarding
-       if (newlhs->getExpressionType() != expr_atom) break;
-
-       const std::string &namelhs = dynamic_cast<const AtomExpr*>(*newlhs)->getName();
-       if (op == op_land && namelhs == "false")
-         return new AtomExpr(gc, mergedPos, boolToAtom(false));
-       if (op == op_lor && namelhs != "false")
-         return new AtomExpr(gc, mergedPos, boolToAtom(true));
+       Value newlhs = ::evalValue(gc, env, lhs);
+       if (!newlhs) return newlhs; // error forwarding
+       if (!newlhs.isAtom()) break;
 
-       StackFrameObj<Expr> newrhs(env, ::eval(gc, env, rhs));
-       if (!newrhs) return nullptr; // error forwarding
-       if (newrhs->getExpressionType() != expr_atom) break;
+       if (op == op_land && !newlhs.isTrue())
+         return Value::fromBool(false);
+       if (op == op_lor && newlhs.isTrue())
+         return Value::fromBool(true);
 
-       const std::string &namerhs = dynamic_cast<const AtomExpr*>(*newrhs)->getName();
-       if (op == op_land || op == op_lor)
-         return new AtomExpr(gc, mergedPos, boolToAtom(namerhs != "false"));
+       Value newrhs = ::evalValue(gc, env, rhs);
+       if (!newrhs) return newrhs; // error forwarding
+       if (!newrhs.isAtom()) break;
 
-       break;
+       return Value::fromBool(newrhs.isTrue());
     }
   case op_eq:
   case op_leq:
@@ -279,64 +274,67 @@ Expr *BiOpExpr::eval(GCMain &gc, Environment &env) noexcept {
   case op_mul:
   case op_div:
   case op_pow: {
-              StackFrameObj<Expr> newlhs(env), newrhs(env);
-              newlhs = ::eval(gc, env, lhs);
-              if (!newlhs) return nullptr;
-              newrhs = ::eval(gc, env, rhs);
-              if (!newrhs) return nullptr;
-             
+              Value newlhs, newrhs;
+              // Independent function applications may be evaluated in
+              // parallel
+              bool parallel = env.pool && env.pool->shouldSpawn(lhs, rhs);
+              if (parallel)
+                env.pool->evalBoth(gc, env, lhs, rhs, newlhs, newrhs);
+              else
+                newlhs = ::evalValue(gc, env, lhs);
+
+              if (!newlhs) return newlhs; // error forwarding
+              // Boxed values must survive evaluation of rhs
+              StackFrameObj<Expr> lhsObj(env, newlhs.getExpr());
+              if (!parallel)
+                newrhs = ::evalValue(gc, env, rhs);
+
+              if (!newrhs) return newrhs; // error forwarding
+
               if (op == op_eq)
-                return new AtomExpr(gc, mergedPos,
-                    boolToAtom(newlhs->equals(*newrhs, false)));
-
-              if (newlhs->getExpressionType() == expr_num
-                  && newrhs-> getExpressionType() == expr_num) {
-                return biopeval(gc, env, mergedPos, op,
-                    dynamic_cast<const NumExpr*>(*newlhs),
-                    dynamic_cast<const NumExpr*>(*newrhs));
-              } else if (newlhs->getExpressionType() == expr_int
-                  && newrhs->getExpressionType() == expr_int){
-                return biopeval(gc, env, mergedPos, op,
-                    dynamic_cast<const IntExpr*>(*newlhs),
-                    dynamic_cast<const IntExpr*>(*newrhs));
-              }
-
-               break;
+                return Value::fromBool(
+                    valueEquals(gc, getTokenPos(), newlhs, newrhs));
+
+              if (newlhs.isNum() && newrhs.isNum())
+                return biopeval(op, newlhs.getNum(), newrhs.getNum());
+              else if (newlhs.isInt() && newrhs.isInt())
+                return biopeval(op, newlhs.getInt(), newrhs.getInt());
+
+              break;
             }
-  case op_fn:
-    return evalLambdaSubstitution(gc, env, mergedPos,
-        this, lhs, rhs);
   }
 
-  return reportSyntaxError(*env.lexer, 
+  return Value(reportSyntaxError(*env.lexer,
       "Invalid use of binary operator.",
-      this->getTokenPos());
+      this->getTokenPos()));
 }
 
 Expr *UnOpExpr::eval(GCMain &gc, Environment &env) noexcept {
-  Expr *newexpr = ::eval(gc, env, expr);
-  if (!newexpr) return nullptr;
+  return evalValue(gc, env).toExpr(gc, getTokenPos());
+}
 
-  if (newexpr->getExpressionType() == expr_num)
+Value UnOpExpr::evalValue(GCMain &gc, Environment &env) noexcept {
+  Value newexpr = ::evalValue(gc, env, expr);
+  if (!newexpr) return newexpr; // error forwarding
+
+  if (newexpr.isNum())
     switch (op) {
     case op_add:
       return newexpr;
     case op_sub:
-      return new NumExpr(gc, newexpr->getTokenPos(),
-          -dynamic_cast<const NumExpr*>(newexpr)->getNumber());
+      return Value::fromNum(-newexpr.getNum());
     }
-  else if (newexpr->getExpressionType() == expr_int)
+  else if (newexpr.isInt())
     switch (op){
     case op_add:
       return newexpr;
     case op_sub:
-      return new IntExpr(gc, newexpr->getTokenPos(),
-          -dynamic_cast<const IntExpr*>(newexpr)->getNumber());
+      return Value::fromInt(-newexpr.getInt());
     }
 
-  return reportSyntaxError(*env.lexer,
+  return Value(reportSyntaxError(*env.lexer,
       "Invalid unary operator expression.",
-      getTokenPos());
+      getTokenPos()));
 }
 
 Expr *IdExpr::eval(GCMain &gc, Environment &env) noexcept {
@@ -344,6 +342,10 @@ Expr *IdExpr::eval(GCMain &gc, Environment &env) noexcept {
 
   const Expr *val = env.get(getName());
   if (!val) {
+    // Builtins not resolved while parsing (e.g. in '$' expressions)
+    if (const Builtin *builtin = findBuiltin(getName()))
+      return new BuiltinExpr(gc, getTokenPos(), builtin);
+
     return reportSyntaxError(*env.lexer, "Variable " + id + " doesn't exist.",
       this->getTokenPos());
   }
@@ -351,22 +353,60 @@ Expr *IdExpr::eval(GCMain &gc, Environment &env) noexcept {
   return const_cast<Expr*>(val);
 }
 
+bool IfExpr::evalGuards(GCMain &gc, Environment &env, Expr *&result) noexcept {
+  // Guards of this case and the following cases
+  std::vector<IfExpr*> cases{this};
+  std::vector<Expr*> conditions{condition};
+  while (cases.back()->exprFalse->getExpressionType() == expr_if) {
+    IfExpr *next = dynamic_cast<IfExpr*>(cases.back()->exprFalse);
+    if (!next->isCaseGuard())
+      break;
+
+    cases.push_back(next);
+    conditions.push_back(next->condition);
+  }
+
+  if (!env.pool->shouldSpeculate(conditions))
+    return false;
+
+  Value resCondition;
+  std::size_t i = env.pool->evalFirst(gc, env, conditions, resCondition);
+  if (i == cases.size()) // no case matched
+    result = ::eval(gc, env, cases.back()->exprFalse);
+  else if (!resCondition)
+    result = nullptr;
+  else if (!resCondition.isAtom())
+    result = reportSyntaxError(*env.lexer,
+        "Invalid if condition. Doesn't evaluate to atom.",
+        cases[i]->getTokenPos());
+  else
+    result = ::eval(gc, env, cases[i]->exprTrue);
+
+  return true;
+}
+
 Expr *IfExpr::eval(GCMain &gc, Environment &env) noexcept {
   StackFrameObj<Expr> thisObj(env, this);
 
-  StackFrameObj<Expr> resCondition(env, ::eval(gc, env, condition));
+  if (caseGuard && env.pool && env.pool->getParallelGuards()
+      && exprFalse->getExpressionType() == expr_if) {
+    // Evaluate guards of the following cases speculatively
+    Expr *result;
+    if (evalGuards(gc, env, result))
+      return result;
+  }
+
+  Value resCondition = ::evalValue(gc, env, condition);
   if (!resCondition)
     return nullptr;
 
-  if (resCondition->getExpressionType() != expr_atom) {
+  if (!resCondition.isAtom()) {
     return reportSyntaxError(*env.lexer,
         "Invalid if condition. Doesn't evaluate to atom.",
         getTokenPos());
   }
 
-  AtomExpr *cond = dynamic_cast<AtomExpr*>(*resCondition);
-
-  if (cond->getName() != "false")
+  if (resCondition.isTrue())
     return ::eval(gc, env, exprTrue);
   else
     return ::eval(gc, env, exprFalse);
@@ -462,7 +502,7 @@ Expr *FunctionExpr::eval(GCMain &gc, Environment &env) noexcept {
           TokenPos(fncase.first.at(0)->getTokenPos(),
                    fncase.first.at(fncase.first.size() - 1)->getTokenPos()),
           *exprCondition, *exprFnBody, 
-          lambdaFn ? *lambdaFn : *noMatch);
+          lambdaFn ? *lambdaFn : *noMatch, true);
     }
   }
 
@@ -479,3 +519,95 @@ Expr *FunctionExpr::eval(GCMain &gc, Environment &env) noexcept {
 }
 
 
+
+bool ThunkExpr::isValue(const Expr *expr) noexcept {
+  switch (expr->getExpressionType()) {
+  case expr_num:
+  case expr_int:
+  case expr_id:
+  case expr_lambda:
+  case expr_atom:
+  case expr_any:
+  case expr_fn:
+  case expr_thunk:
+  case expr_builtin:
+  case expr_future:
+    return true;
+  }
+
+  return false;
+}
+
+EvalContext *&currentEvalContext() noexcept {
+  static thread_local EvalContext threadContext{{}, std::this_thread::get_id()};
+  static thread_local EvalContext *context = &threadContext;
+  return context;
+}
+
+Expr *ThunkExpr::eval(GCMain &gc, Environment &env) noexcept {
+  if (evaluated.load(std::memory_order_acquire))
+    return expr.load(std::memory_order_relaxed);
+
+  // The address of the context identifies the evaluation forcing the thunk
+  EvalContext *context = currentEvalContext();
+  std::vector<const ThunkExpr*> &sharedThunks = context->sharedThunks;
+
+  StackFrameObj<Expr> thisObj(env, this);
+
+  const void *owner = nullptr;
+  bool shared = false;
+  while (!evaluator.compare_exchange_strong(owner, context)) {
+    if (owner == context
+        || std::find(sharedThunks.begin(), sharedThunks.end(), this)
+          != sharedThunks.end())
+      return reportSyntaxError(*env.lexer,
+          "Endless term detected.",
+          getTokenPos());
+
+    std::thread::id thread = evaluatorThread.load();
+    if (!env.pool || thread == std::thread::id()
+        || thread == std::this_thread::get_id()) {
+      // The forcing evaluation is suspended (a coroutine or below this one
+      // on the stack): evaluate the thunk, too (evaluation is
+      // deterministic, so both publish equal values)
+      shared = true;
+      sharedThunks.push_back(this);
+      break;
+    }
+
+    // Another worker forces the thunk: wait for its value (and help other
+    // workers meanwhile)
+    waiting.store(true);
+    env.pool->waitUntil(env, [this] {
+          return evaluated.load() || !evaluator.load() || isCancelled();
+        });
+
+    if (evaluated.load(std::memory_order_acquire))
+      return expr.load(std::memory_order_relaxed);
+    if (isCancelled())
+      return nullptr;
+
+    owner = nullptr; // the other worker failed: force it again
+  }
+
+  if (!shared)
+    evaluatorThread.store(context->thread);
+
+  Expr *result = ::eval(gc, env, expr.load(std::memory_order_relaxed));
+  if (result) {
+    // Overwrite delayed expression with its value
+    expr.store(result, std::memory_order_relaxed);
+    evaluated.store(true, std::memory_order_release);
+  }
+
+  if (shared)
+    sharedThunks.pop_back();
+  else {
+    evaluatorThread.store(std::thread::id());
+    evaluator.store(nullptr);
+    if (waiting.load() && env.pool)
+      env.pool->notify();
+  }
+
+  return result; // nullptr: error forwarding
+}
@@ -182,7 +182,8 @@ Expr *IfExpr::optimize(GCMain &gc, std::vector<Expr*> &exprs) noexcept {
       && newTrue == exprTrue && newFalse == exprFalse)
     return this; // no changes
 
-  return new IfExpr(gc, getTokenPos(), newcondition, newTrue, newFalse);
+  return new IfExpr(gc, getTokenPos(), newcondition, newTrue, newFalse,
+      caseGuard);
 }
 
 
@@ -10,18 +10,29 @@ Expr *LambdaExpr::replace(GCMain &gc, const std::string &name, Expr *newexpr) co
   if (name == getName())
     return const_cast<Expr*>(dynamic_cast<const Expr*>(this));
 
-  return new LambdaExpr(gc, getTokenPos(), getName(), expr->replace(gc, name, newexpr));
+  Expr *newbody = expr->replace(gc, name, newexpr);
+  if (newbody == expr) // no changes
+    return const_cast<Expr*>(dynamic_cast<const Expr*>(this));
+
+  ++evalStats.replaceCopies;
+  return new LambdaExpr(gc, getTokenPos(), getName(), newbody);
 }
 
 Expr *BiOpExpr::replace(GCMain &gc, const std::string &name, Expr *newexpr) const noexcept {
-  return new BiOpExpr(gc, this->getTokenPos(), op,
-      lhs->replace(gc, name, newexpr),
-      rhs->replace(gc, name, newexpr));
+  Expr *newlhs = lhs->replace(gc, name, newexpr);
+  Expr *newrhs = rhs->replace(gc, name, newexpr);
+  if (newlhs == lhs && newrhs == rhs) // no changes
+    return const_cast<Expr*>(dynamic_cast<const Expr*>(this));
+
+  ++evalStats.replaceCopies;
+  return new BiOpExpr(gc, this->getTokenPos(), op, newlhs, newrhs);
 }
 
 Expr *IdExpr::replace(GCMain &gc, const std::string &name, Expr *newexpr) const noexcept {
-  if (name.empty())
+  if (name.empty()) {
+    ++evalStats.replaceCopies;
     return new AnyExpr(gc, getTokenPos());
+  }
 
   if (name == getName())
     return newexpr;
@@ -30,10 +41,16 @@ Expr *IdExpr::replace(GCMain &gc, const std::string &name, Expr *newexpr) const
 }
 
 Expr *IfExpr::replace(GCMain &gc, const std::string &name, Expr *newexpr) const noexcept {
-  return new IfExpr(gc, getTokenPos(),
-      condition->replace(gc, name, newexpr),
-      exprTrue->replace(gc, name, newexpr),
-      exprFalse->replace(gc, name, newexpr));
+  Expr *newcondition = condition->replace(gc, name, newexpr);
+  Expr *newTrue = exprTrue->replace(gc, name, newexpr);
+  Expr *newFalse = exprFalse->replace(gc, name, newexpr);
+  if (newcondition == condition
+      && newTrue == exprTrue && newFalse == exprFalse) // no changes
+    return const_cast<Expr*>(dynamic_cast<const Expr*>(this));
+
+  ++evalStats.replaceCopies;
+  return new IfExpr(gc, getTokenPos(), newcondition, newTrue, newFalse,
+      caseGuard);
 }
 
 Expr *LetExpr::replace(GCMain &gc, const std::string &name, Expr *expr) const noexcept {
@@ -48,6 +65,7 @@ Expr *LetExpr::replace(GCMain &gc, const std::string &name, Expr *expr) const no
       Expr *newasgrhs = asg->getRHS().replace(gc, name, expr);
       if (newasgrhs != &asg->getRHS()) {
         changedAsg = true;
+        ++evalStats.replaceCopies;
         newassignments.push_back(new BiOpExpr(gc, asg->getTokenPos(),
               op_asg,
               const_cast<Expr*>(&asg->getLHS()), newasgrhs));
@@ -62,13 +80,28 @@ Expr *LetExpr::replace(GCMain &gc, const std::string &name, Expr *expr) const no
     if (newbody == body && !changedAsg)
       return const_cast<Expr*>(dynamic_cast<const Expr*>(this));
 
+    ++evalStats.replaceCopies;
     return new LetExpr(gc, getTokenPos(),
         changedAsg ? newassignments : assignments, newbody);
   }
 
-  if (changedAsg)
+  if (changedAsg) {
+    ++evalStats.replaceCopies;
     return new LetExpr(gc, getTokenPos(), newassignments, body);
+  }
 
   return const_cast<Expr*>(dynamic_cast<const Expr*>(this));
 }
 
+Expr *ThunkExpr::replace(GCMain &gc, const std::string &name, Expr *newexpr) const noexcept {
+  const Expr *oldexpr = &getExpression();
+  Expr *result = oldexpr->replace(gc, name, newexpr);
+  if (result == oldexpr) // no changes, keep sharing the thunk
+    return const_cast<Expr*>(dynamic_cast<const Expr*>(this));
+
+  if (isEvaluated() || ThunkExpr::isValue(result))
+    return result;
+
+  ++evalStats.replaceCopies;
+  return new ThunkExpr(gc, result);
+}
@@ -0,0 +1,81 @@
+#include "func/syntax.hpp"
+
+// strictness analysis
+
+bool BiOpExpr::isStrict(const std::string &name) const noexcept {
+  switch (op) {
+  case op_asg:
+    return false;
+  case op_land:
+  case op_lor:
+    // rhs is evaluated lazily
+    return lhs->isStrict(name);
+  case op_fn:
+    // function is always evaluated, the argument only if the function
+    // itself is a lambda function, which is strict in its parameter
+    if (lhs->isStrict(name))
+      return true;
+
+    return lhs->getExpressionType() == expr_lambda
+      && dynamic_cast<const LambdaExpr*>(lhs)->isStrictParameter()
+      && rhs->isStrict(name);
+  }
+
+  // arithmetic, comparisons: both sides are evaluated
+  return lhs->isStrict(name) || rhs->isStrict(name);
+}
+
+bool UnOpExpr::isStrict(const std::string &name) const noexcept {
+  return expr->isStrict(name);
+}
+
+bool LambdaExpr::isStrictParameter() const noexcept {
+  signed char result = strict.load(std::memory_order_relaxed);
+  if (result < 0) {
+    result = expr->isStrict(name) ? 1 : 0;
+    strict.store(result, std::memory_order_relaxed);
+  }
+
+  return result > 0;
+}
+
+bool IfExpr::isStrict(const std::string &name) const noexcept {
+  if (condition->isStrict(name))
+    return true;
+
+  return exprTrue->isStrict(name) && exprFalse->isStrict(name);
+}
+
+bool LetExpr::isStrict(const std::string &name) const noexcept {
+  bool shadowed = false;
+  for (BiOpExpr *asg : assignments) {
+    // pattern matching assignments evaluate their RHS (function
+    // definitions don't)
+    if (asg->getLHS().getExpressionType() == expr_biop
+        && dynamic_cast<const BiOpExpr&>(asg->getLHS()).isAtomConstructor()
+        && asg->getRHS().isStrict(name))
+      return true;
+
+    for (const std::string &id : asg->getLHS().getIdentifiers())
+      if (id == name)
+        shadowed = true;
+  }
+
+  if (shadowed)
+    return false;
+
+  if (body->isStrict(name))
+    return true;
+
+  // identifier assignments are substituted into the body
+  for (BiOpExpr *asg : assignments) {
+    if (asg->getLHS().getExpressionType() != expr_id)
+      continue;
+
+    const std::string &id = dynamic_cast<const IdExpr&>(asg->getLHS()).getName();
+    if (asg->getRHS().isStrict(name) && body->isStrict(id))
+      return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,61 @@
+#include "func/trace.hpp"
+
+//! Count of threads, which wrote spans
+static std::atomic<std::size_t> countThreads{0};
+//! Number of the current thread in traces (0 if not assigned yet)
+static thread_local std::size_t threadNumber = 0;
+
+//!\return Returns str as JSON string.
+static std::string escape(const std::string &str) {
+  std::string result = "\"";
+  for (char c : str) {
+    switch (c) {
+    case '"': result += "\\\""; break;
+    case '\\': result += "\\\\"; break;
+    case '\n': result += "\\n"; break;
+    case '\t': result += "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+        result += buf;
+      } else
+        result += c;
+    }
+  }
+
+  return result + "\"";
+}
+
+Tracer::Tracer(const std::string &filename)
+    : out(filename), start{now()} {
+  if (out)
+    out << "[";
+}
+
+Tracer::~Tracer() {
+  if (out)
+    out << "\n]" << std::endl;
+}
+
+void Tracer::span(const std::string &name, const char *category,
+    TimePoint begin, TimePoint end, const TokenPos *pos) noexcept {
+  if (!threadNumber)
+    threadNumber = ++countThreads;
+
+  typedef std::chrono::duration<double, std::micro> Micros;
+  std::ostringstream event;
+  event << "{\"name\":" << escape(name)
+    << ",\"cat\":\"" << category << "\",\"ph\":\"X\""
+    << ",\"ts\":" << Micros(begin - start).count()
+    << ",\"dur\":" << Micros(end - begin).count()
+    << ",\"pid\":1,\"tid\":" << threadNumber;
+  if (pos)
+    event << ",\"args\":{\"line\":" << pos->getLineStart() + 1
+      << ",\"column\":" << pos->getStart() << "}";
+  event << "}";
+
+  std::lock_guard<std::mutex> lock(mutex);
+  out << (first ? "\n" : ",\n") << event.str();
+  first = false;
+}
@@ -0,0 +1,523 @@
+#include "func/typecheck.hpp"
+#include <deque>
+
+static const Type *find(const Type *type) noexcept {
+  while (type->kind == type_var && type->link)
+    type = type->link;
+
+  return type;
+}
+
+static Type *find(Type *type) noexcept {
+  return const_cast<Type*>(find(const_cast<const Type*>(type)));
+}
+
+std::string toString(const Type *type) noexcept {
+  type = find(type);
+  switch (type->kind) {
+  case type_var: return "a";
+  case type_dyn: return "_";
+  case type_int: return "int";
+  case type_num: return "num";
+  case type_atom: return "atom";
+  case type_fn: {
+      std::string param = toString(type->param);
+      if (find(type->param)->kind == type_fn)
+        param = "(" + param + ")";
+
+      return param + " -> " + toString(type->result);
+    }
+  }
+
+  return "_";
+}
+
+/*!\brief Infers types of one top level expression.
+ */
+class TypeInference {
+  /*!\brief Identifier bound by a lambda function, let expression or pattern.
+   */
+  struct Binding {
+    std::string name;
+    Type *type; //!< nullptr if let binding (rhs is inferred at every use)
+    const Expr *rhs; //!< Expression assigned by let
+    std::size_t scopeSize; //!< Visible bindings of rhs
+  };
+
+  GCMain &gc;
+  Environment &env;
+  std::deque<Type> types; //!< All types created
+  std::vector<Type*> trail; //!< Bound variables (undone if unify fails)
+  std::vector<Binding> scope;
+  //! Types of top level definitions (generalized)
+  std::map<const Expr*, Type*> globals;
+  //! Top level definitions being inferred (monomorphic)
+  std::map<const Expr*, Type*> inProgress;
+  bool failed = false;
+  bool quiet = false; //!< Errors aren't reported (delayed argument)
+
+  Type *newType(TypeKind kind, Type *param = nullptr, Type *result = nullptr) {
+    types.emplace_back(kind, param, result);
+    return &types.back();
+  }
+
+  Type *dyn() { return newType(type_dyn); }
+
+  bool occurs(const Type *var, const Type *type) const noexcept {
+    type = find(type);
+    if (type == var)
+      return true;
+
+    return type->kind == type_fn
+      && (occurs(var, type->param) || occurs(var, type->result));
+  }
+
+  bool unifyTypes(Type *a, Type *b) noexcept {
+    a = find(a);
+    b = find(b);
+    if (a == b || a->kind == type_dyn || b->kind == type_dyn)
+      return true;
+
+    if (a->kind == type_var || b->kind == type_var) {
+      if (a->kind != type_var)
+        std::swap(a, b);
+
+      if (occurs(a, b))
+        return false;
+
+      a->link = b;
+      trail.push_back(a);
+      return true;
+    }
+
+    if (a->kind != b->kind)
+      return false;
+
+    if (a->kind == type_fn)
+      return unifyTypes(a->param, b->param)
+        && unifyTypes(a->result, b->result);
+
+    return true;
+  }
+
+  /*!\return Returns true if a and b could be unified. If not, nothing was
+   * changed.
+   */
+  bool unify(Type *a, Type *b) noexcept {
+    std::size_t trailSize = trail.size();
+    if (unifyTypes(a, b))
+      return true;
+
+    while (trail.size() > trailSize) {
+      trail.back()->link = nullptr;
+      trail.pop_back();
+    }
+
+    return false;
+  }
+
+  /*!\return Returns a if a and b are unifiable, otherwise type_dyn.
+   */
+  Type *join(Type *a, Type *b) noexcept {
+    return unify(a, b) ? a : dyn();
+  }
+
+  /*!\return Returns type with new variables (for every use of a top level
+   * definition).
+   */
+  Type *instantiate(Type *type, std::map<Type*, Type*> &vars) {
+    type = find(type);
+    switch (type->kind) {
+    case type_var: {
+        auto it = vars.find(type);
+        if (it != vars.end())
+          return it->second;
+
+        return vars[type] = newType(type_var);
+      }
+    case type_fn:
+      return newType(type_fn, instantiate(type->param, vars),
+          instantiate(type->result, vars));
+    }
+
+    return type;
+  }
+
+  Type *error(const std::string &msg, const TokenPos &pos) {
+    if (!failed && !quiet)
+      reportSyntaxError(*env.lexer, "Type error: " + msg, pos);
+
+    failed = true;
+    return dyn();
+  }
+
+  /*!\return Returns type of pattern and binds its identifiers.
+   */
+  Type *inferPattern(const Expr *pattern) {
+    switch (pattern->getExpressionType()) {
+    case expr_id: {
+        Type *type = newType(type_var);
+        scope.push_back(Binding{
+            dynamic_cast<const IdExpr*>(pattern)->getName(),
+            type, nullptr, 0});
+        return type;
+      }
+    case expr_int:
+      return newType(type_int);
+    case expr_num:
+      return newType(type_num);
+    case expr_atom:
+      return newType(type_atom);
+    case expr_biop:
+      // Fields of atom constructors aren't typed
+      for (std::string &id : pattern->getIdentifiers())
+        scope.push_back(Binding{id, dyn(), nullptr, 0});
+
+      if (dynamic_cast<const BiOpExpr*>(pattern)->isAtomConstructor())
+        return newType(type_atom);
+    }
+
+    return dyn();
+  }
+
+  /*!\return Returns type of expression assigned to top level identifier.
+   */
+  Type *inferGlobal(const Expr *value) {
+    auto it = globals.find(value);
+    if (it != globals.end()) {
+      std::map<Type*, Type*> vars;
+      return instantiate(it->second, vars);
+    }
+
+    it = inProgress.find(value);
+    if (it != inProgress.end())
+      return it->second; // recursion
+
+    Type *self = newType(type_var);
+    inProgress[value] = self;
+
+    std::vector<Binding> oldscope;
+    std::swap(scope, oldscope);
+
+    Type *result = nullptr;
+    if (value->getExpressionType() == expr_fn) {
+      for (auto &fncase : dynamic_cast<const FunctionExpr*>(value)->getFunctionCases()) {
+        std::vector<Type*> params;
+        for (Expr *pattern : fncase.first)
+          params.push_back(inferPattern(pattern));
+
+        Type *caseType = infer(fncase.second);
+        for (auto it = params.rbegin(); it != params.rend(); ++it)
+          caseType = newType(type_fn, *it, caseType);
+
+        scope.clear();
+        result = result ? join(result, caseType) : caseType;
+      }
+    } else
+      result = infer(value);
+
+    std::swap(scope, oldscope);
+
+    unify(self, result);
+    inProgress.erase(value);
+    globals[value] = result;
+
+    std::map<Type*, Type*> vars;
+    return instantiate(result, vars);
+  }
+
+  Type *inferId(const IdExpr *id) {
+    for (auto it = scope.rbegin(); it != scope.rend(); ++it) {
+      if (it->name != id->getName())
+        continue;
+
+      if (it->type)
+        return it->type;
+
+      // let polymorphism: infer assigned expression in its own scope
+      const Expr *rhs = it->rhs;
+      std::vector<Binding> oldscope(scope);
+      scope.resize(it->scopeSize);
+      Type *result = infer(rhs);
+      scope = std::move(oldscope);
+      return result;
+    }
+
+    const Expr *value = env.get(id->getName());
+    if (!value)
+      return dyn(); // builtin or defined later
+
+    return inferGlobal(value);
+  }
+
+  /*!\return Returns true if the argument applied to fn is only evaluated if
+   * it is needed: fn is a lambda function or named function (or a partial
+   * application of one), which isn't strict in this parameter.
+   */
+  bool isLazyApplication(const Expr *fn) const noexcept {
+    // Position of the parameter (arguments applied before)
+    std::size_t index = 0;
+    while (fn->getExpressionType() == expr_biop
+        && dynamic_cast<const BiOpExpr*>(fn)->getOperator() == op_fn) {
+      fn = &dynamic_cast<const BiOpExpr*>(fn)->getLHS();
+      ++index;
+    }
+
+    if (fn->getExpressionType() == expr_id) {
+      const std::string &name = dynamic_cast<const IdExpr*>(fn)->getName();
+      auto it = scope.rbegin();
+      while (it != scope.rend() && it->name != name)
+        ++it;
+
+      // let bindings are known, parameters aren't
+      fn = it != scope.rend() ? it->rhs : env.get(name);
+      if (!fn)
+        return false;
+    }
+
+    if (fn->getExpressionType() == expr_fn) {
+      // Patterns other than identifiers and '_' evaluate the argument
+      for (auto &fncase : dynamic_cast<const FunctionExpr*>(fn)->getFunctionCases()) {
+        if (index >= fncase.first.size())
+          return false;
+
+        const Expr *pattern = fncase.first[index];
+        if (pattern->getExpressionType() == expr_any)
+          continue;
+        if (pattern->getExpressionType() != expr_id
+            || fncase.second->isStrict(
+              dynamic_cast<const IdExpr*>(pattern)->getName()))
+          return false;
+      }
+
+      return true;
+    }
+
+    for (; index > 0 && fn->getExpressionType() == expr_lambda; --index)
+      fn = &dynamic_cast<const LambdaExpr*>(fn)->getExpression();
+
+    return index == 0 && fn->getExpressionType() == expr_lambda
+      && !dynamic_cast<const LambdaExpr*>(fn)->isStrictParameter();
+  }
+
+  /*!\return Returns type of the argument of a lazy application (type_dyn if
+   * it has a type error, which only matters if the argument is needed).
+   */
+  Type *inferLazy(const Expr *arg) {
+    bool oldFailed = failed, oldQuiet = quiet;
+    failed = false;
+    quiet = true;
+    Type *result = infer(arg);
+    if (failed)
+      result = dyn();
+
+    failed = oldFailed;
+    quiet = oldQuiet;
+    return result;
+  }
+
+  Type *inferBiOp(BiOpExpr *biop) {
+    const Expr *lhs = &biop->getLHS();
+    const Expr *rhs = &biop->getRHS();
+    switch (biop->getOperator()) {
+    case op_asg:
+      return dyn();
+    case op_fn: {
+        bool lazy = isLazyApplication(lhs);
+        Type *fn = find(infer(lhs));
+        Type *arg = lazy ? inferLazy(rhs) : infer(rhs);
+        switch (fn->kind) {
+        case type_var: {
+            Type *result = newType(type_var);
+            unify(fn, newType(type_fn, arg, result));
+            return result;
+          }
+        case type_fn:
+          // Conflicting arguments of lazy applications are type_dyn
+          if (!unify(fn->param, arg) && !lazy)
+            return error("Argument of type " + toString(fn->param)
+                + " expected, but got " + toString(arg) + ".",
+                rhs->getTokenPos());
+
+          return fn->result;
+        case type_atom:
+          return fn; // atom constructor
+        }
+
+        return dyn();
+      }
+    case op_land:
+    case op_lor: {
+        Type *atom = newType(type_atom);
+        if (!unify(infer(lhs), atom) || !unify(infer(rhs), atom))
+          return error("Operands of " + std::to_string(biop->getOperator())
+              + " must be atoms.", biop->getTokenPos());
+
+        return atom;
+      }
+    case op_eq:
+      infer(lhs);
+      infer(rhs);
+      return newType(type_atom);
+    }
+
+    // Arithmetic and comparison operators
+    Type *typelhs = infer(lhs);
+    Type *typerhs = infer(rhs);
+    if (!unify(typelhs, typerhs))
+      return error("Operands of " + std::to_string(biop->getOperator())
+          + " have different types " + toString(typelhs) + " and "
+          + toString(typerhs) + ".", biop->getTokenPos());
+
+    switch (find(typelhs)->kind) {
+    case type_atom:
+    case type_fn:
+      return error("Operands of " + std::to_string(biop->getOperator())
+          + " must be numbers, but are " + toString(typelhs) + ".",
+          biop->getTokenPos());
+    }
+
+    switch (biop->getOperator()) {
+    case op_leq:
+    case op_geq:
+    case op_le:
+    case op_gt:
+      return newType(type_atom);
+    }
+
+    return typelhs;
+  }
+
+  Type *inferLet(const LetExpr *letexpr) {
+    std::size_t scopeSize = scope.size();
+
+    // Assignments may refer to each other
+    for (BiOpExpr *asg : letexpr->getAssignments())
+      for (std::string &id : asg->getLHS().getIdentifiers())
+        scope.push_back(Binding{id, dyn(), nullptr, 0});
+
+    std::size_t rhsScopeSize = scope.size();
+    for (BiOpExpr *asg : letexpr->getAssignments()) {
+      infer(&asg->getRHS()); // report errors even if unused
+
+      if (asg->getLHS().getExpressionType() == expr_id)
+        scope.push_back(Binding{
+            dynamic_cast<const IdExpr&>(asg->getLHS()).getName(),
+            nullptr, &asg->getRHS(), rhsScopeSize});
+    }
+
+    Type *result = infer(&letexpr->getBody());
+    scope.resize(scopeSize);
+
+    return result;
+  }
+
+public:
+  TypeInference(GCMain &gc, Environment &env) : gc(gc), env(env) {}
+
+  Type *infer(const Expr *expr) {
+    if (failed)
+      return dyn();
+
+    switch (expr->getExpressionType()) {
+    case expr_int:
+      return newType(type_int);
+    case expr_num:
+      return newType(type_num);
+    case expr_atom:
+      return newType(type_atom);
+    case expr_id:
+      return inferId(dynamic_cast<const IdExpr*>(expr));
+    case expr_fn:
+      return inferGlobal(expr);
+    case expr_lambda: {
+        auto lambda = dynamic_cast<const LambdaExpr*>(expr);
+        Type *param = newType(type_var);
+        scope.push_back(Binding{lambda->getName(), param, nullptr, 0});
+        Type *result = infer(&lambda->getExpression());
+        scope.pop_back();
+
+        return newType(type_fn, param, result);
+      }
+    case expr_unop: {
+        auto unop = dynamic_cast<const UnOpExpr*>(expr);
+        Type *type = infer(&unop->getExpression());
+        switch (find(type)->kind) {
+        case type_atom:
+        case type_fn:
+          return error("Operand of unary operator must be a number, but is "
+              + toString(type) + ".", expr->getTokenPos());
+        }
+
+        return type;
+      }
+    case expr_biop:
+      return inferBiOp(dynamic_cast<BiOpExpr*>(const_cast<Expr*>(expr)));
+    case expr_if: {
+        auto ifexpr = dynamic_cast<const IfExpr*>(expr);
+        if (!unify(infer(&ifexpr->getCondition()), newType(type_atom)))
+          return error("Condition must be an atom.",
+              ifexpr->getCondition().getTokenPos());
+
+        // Branches may differ (e.g. number or .error)
+        return join(infer(&ifexpr->getTrue()), infer(&ifexpr->getFalse()));
+      }
+    case expr_let:
+      return inferLet(dynamic_cast<const LetExpr*>(expr));
+    }
+
+    return dyn();
+  }
+
+  /*!\return Returns type of top level expression (assignments included).
+   */
+  Type *inferTopLevel(const Expr *expr) {
+    if (expr->getExpressionType() != expr_biop
+        || dynamic_cast<const BiOpExpr*>(expr)->getOperator() != op_asg)
+      return infer(expr);
+
+    auto asg = dynamic_cast<const BiOpExpr*>(expr);
+    const Expr *lhs = &asg->getLHS();
+    if (lhs->getExpressionType() != expr_biop
+        || !dynamic_cast<const BiOpExpr*>(lhs)->isFunctionConstructor())
+      return infer(&asg->getRHS());
+
+    // Named function case
+    std::vector<const Expr*> patterns;
+    while (lhs->getExpressionType() == expr_biop) {
+      patterns.insert(patterns.begin(),
+          &dynamic_cast<const BiOpExpr*>(lhs)->getRHS());
+      lhs = &dynamic_cast<const BiOpExpr*>(lhs)->getLHS();
+    }
+
+    const std::string &fnname = dynamic_cast<const IdExpr*>(lhs)->getName();
+    const Expr *fn = env.currentGet(fnname);
+    if (fn && fn->getExpressionType() == expr_fn) {
+      std::size_t arity = dynamic_cast<const FunctionExpr*>(fn)
+        ->getFunctionCases().front().first.size();
+      if (arity != patterns.size())
+        return error("Function " + fnname + " expects "
+            + std::to_string(arity) + " arguments, but case has "
+            + std::to_string(patterns.size()) + ".", expr->getTokenPos());
+    }
+
+    for (const Expr *pattern : patterns)
+      inferPattern(pattern);
+
+    Type *result = infer(&asg->getRHS());
+    scope.clear();
+
+    return result;
+  }
+
+  bool hasFailed() const noexcept { return failed; }
+};
+
+Expr *TypeInferencePass::apply(GCMain &gc, Environment &env, Expr *expr) noexcept {
+  TypeInference inference(gc, env);
+  inference.inferTopLevel(expr);
+  if (inference.hasFailed())
+    return nullptr;
+
+  return expr;
+}
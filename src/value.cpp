@@ -0,0 +1,54 @@
+#include "func/syntax.hpp"
+
+Value Value::unbox(Expr *expr) noexcept {
+  if (!expr)
+    return Value();
+
+  switch (expr->getExpressionType()) {
+  case expr_int:
+    return fromInt(dynamic_cast<IntExpr*>(expr)->getNumber());
+  case expr_num:
+    return fromNum(dynamic_cast<NumExpr*>(expr)->getNumber());
+  case expr_atom: {
+      const std::string &name = dynamic_cast<AtomExpr*>(expr)->getName();
+      if (name == "true")
+        return fromBool(true);
+      if (name == "false")
+        return fromBool(false);
+
+      break;
+    }
+  }
+
+  return Value(expr);
+}
+
+bool Value::isAtom() const noexcept {
+  if (type == val_bool)
+    return true;
+
+  return type == val_expr && expr && expr->getExpressionType() == expr_atom;
+}
+
+bool Value::isTrue() const noexcept {
+  if (type == val_bool)
+    return boolean;
+
+  if (isAtom())
+    return dynamic_cast<const AtomExpr*>(expr)->getName() != "false";
+
+  return true;
+}
+
+Expr *Value::toExpr(GCMain &gc, const TokenPos &pos) const noexcept {
+  switch (type) {
+  case val_int:
+    return new IntExpr(gc, pos, integer);
+  case val_num:
+    return new NumExpr(gc, pos, number);
+  case val_bool:
+    return new AtomExpr(gc, pos, boolean ? "true" : "false");
+  }
+
+  return expr;
+}
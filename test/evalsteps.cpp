@@ -0,0 +1,181 @@
+/**
+ * test/evalsteps.cpp
+ * -----------------------------------------------------------------------------
+ * Interprets the file (first argument) and then the expressions (second
+ * argument). Writes the count of reduction steps needed.
+ *
+ * With baselines it fails, if the reduction steps, the allocated objects or
+ * the peak of live objects exceed their baseline by more than --tolerance
+ * percent (default 5).
+ *
+ * Usage: evalsteps [--opt-level N] [--typecheck] [--threads N]
+ *   [--parallel-guards] [--max-steps N] [--timeout MS] [--max-objects N]
+ *   [--stats] [--profile] [--trace FILE] [--sample FILE]
+ *   [--baseline-steps N] [--baseline-allocated N] [--baseline-live N]
+ *   [--tolerance PERCENT] <file> <expressions>
+ */
+
+#include "func/func.hpp"
+#include <sstream>
+
+/*!\brief Writes value and baseline (if not 0).
+ * \return Returns false if value exceeds baseline by more than tolerance
+ * percent.
+ */
+static bool checkBaseline(const std::string &name, std::size_t value,
+    std::size_t baseline, double tolerance) {
+  if (baseline == 0)
+    return true;
+
+  std::cout << name << ": " << value << " (baseline " << baseline << ")"
+    << std::endl;
+  if (value > baseline * (1 + tolerance / 100)) {
+    std::cout << "Regression: " << name << " exceed the baseline by more than "
+      << tolerance << "%." << std::endl;
+    return false;
+  }
+  if (value < baseline * (1 - tolerance / 100))
+    std::cout << "Improvement: Update the baseline of " << name << "."
+      << std::endl;
+
+  return true;
+}
+
+int main(int vargsc, char * vargs[]) {
+  int optLevel = 1;
+  bool typeCheck = false;
+  int threads = 1;
+  bool parallelGuards = false;
+  EvalLimits limits;
+  std::size_t maxObjects = 0;
+  bool profile = false;
+  bool stats = false;
+  const char *traceFile = nullptr;
+  const char *sampleFile = nullptr;
+  std::size_t baselineSteps = 0, baselineAllocated = 0, baselineLive = 0;
+  double tolerance = 5;
+  while (vargsc > 3 && vargs[1][0] == '-') {
+    std::string arg = vargs[1];
+    if (arg == "--opt-level") {
+      optLevel = std::atoi(vargs[2]);
+      ++vargs;
+      --vargsc;
+    } else if (arg == "--threads") {
+      threads = std::atoi(vargs[2]);
+      ++vargs;
+      --vargsc;
+    } else if (arg == "--max-steps") {
+      limits.maxSteps = std::strtoull(vargs[2], nullptr, 10);
+      ++vargs;
+      --vargsc;
+    } else if (arg == "--timeout") {
+      limits.timeout = std::atof(vargs[2]);
+      ++vargs;
+      --vargsc;
+    } else if (arg == "--max-objects") {
+      maxObjects = std::strtoull(vargs[2], nullptr, 10);
+      ++vargs;
+      --vargsc;
+    } else if (arg == "--baseline-steps") {
+      baselineSteps = std::strtoull(vargs[2], nullptr, 10);
+      ++vargs;
+      --vargsc;
+    } else if (arg == "--baseline-allocated") {
+      baselineAllocated = std::strtoull(vargs[2], nullptr, 10);
+      ++vargs;
+      --vargsc;
+    } else if (arg == "--baseline-live") {
+      baselineLive = std::strtoull(vargs[2], nullptr, 10);
+      ++vargs;
+      --vargsc;
+    } else if (arg == "--tolerance") {
+      tolerance = std::atof(vargs[2]);
+      ++vargs;
+      --vargsc;
+    } else if (arg == "--sample") {
+      sampleFile = vargs[2];
+      ++vargs;
+      --vargsc;
+    } else if (arg == "--trace") {
+      traceFile = vargs[2];
+      ++vargs;
+      --vargsc;
+    } else if (arg == "--stats")
+      stats = true;
+    else if (arg == "--profile")
+      profile = true;
+    else if (arg == "--parallel-guards")
+      parallelGuards = true;
+    else if (arg == "--typecheck")
+      typeCheck = true;
+    else
+      return 1;
+
+    ++vargs;
+    --vargsc;
+  }
+
+  if (vargsc != 3)
+    return 1;
+
+  Optimizer optimizer(optLevel, typeCheck);
+
+  std::unique_ptr<Tracer> tracer;
+  if (traceFile)
+    tracer.reset(new Tracer(traceFile));
+
+  std::vector<std::string> lines;
+  GCMain gc;
+  gc.setTracer(tracer.get());
+  gc.setMaxObjects(maxObjects);
+  std::unique_ptr<ThreadPool> pool;
+  if (threads > 1) {
+    pool.reset(new ThreadPool(gc, threads));
+    pool->setParallelGuards(parallelGuards);
+  }
+
+  Profiler profiler;
+  std::unique_ptr<Sampler> sampler;
+  if (sampleFile)
+    sampler.reset(new Sampler());
+
+  Environment *env = new Environment(gc);
+  env->optimizer = &optimizer;
+  env->pool = pool.get();
+  env->profiler = profile ? &profiler : nullptr;
+  env->tracer = tracer.get();
+
+  MappedFile file(vargs[1]);
+  if (!file.isOpen()) {
+    std::cerr << "Failed opening file \"" << vargs[1] << "\"." << std::endl;
+    return 1;
+  }
+
+  if (!interpret(file, gc, lines, env, limits))
+    return 1;
+
+  std::istringstream istrstream(vargs[2]);
+  bool success = interpret(istrstream, gc, lines, env, false, limits);
+
+  std::cout << "steps: " << getReductionSteps() << std::endl;
+  if (stats)
+    getEvalStats().print(std::cout);
+
+  if (profile)
+    profiler.print(std::cout);
+
+  if (sampler) {
+    std::ofstream sampleOutput(sampleFile);
+    sampler->write(sampleOutput, lines);
+  }
+
+  bool withinBaselines =
+    checkBaseline("reduction steps", getReductionSteps(), baselineSteps,
+        tolerance)
+    & checkBaseline("allocated objects", GCMain::getTotalAllocated(),
+        baselineAllocated, tolerance)
+    & checkBaseline("peak live objects", gc.getPeakObjects(), baselineLive,
+        tolerance);
+
+  return success && withinBaselines ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+/**
+ * test/interrupt.cpp
+ * -----------------------------------------------------------------------------
+ * Interprets the file (first argument) and then the expressions (second
+ * argument). Another thread interrupts the first evaluation running after the
+ * given milliseconds (third argument).
+ *
+ * Usage: interrupt <file> <expressions> <milliseconds>
+ */
+
+#include "func/func.hpp"
+#include <sstream>
+
+int main(int vargsc, char * vargs[]) {
+  if (vargsc != 4)
+    return 1;
+
+  std::vector<std::string> lines;
+  GCMain gc;
+  Environment *env = new Environment(gc);
+
+  std::ifstream input(vargs[1]);
+  if (!input) {
+    std::cerr << "Failed opening file \"" << vargs[1] << "\"." << std::endl;
+    return 1;
+  }
+
+  if (!interpret(input, gc, lines, env))
+    return 1;
+
+  std::chrono::milliseconds delay(std::atoi(vargs[3]));
+  std::thread interrupter([delay]() {
+    std::this_thread::sleep_for(delay);
+    while (!interruptEvaluation())
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+
+  std::istringstream istrstream(vargs[2]);
+  bool success = interpret(istrstream, gc, lines, env);
+  interrupter.join();
+
+  return success ? 0 : 1;
+}
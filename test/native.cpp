@@ -0,0 +1,47 @@
+/**
+ * test/native.cpp
+ * -----------------------------------------------------------------------------
+ * Registers native functions and interprets the expressions (first argument).
+ */
+
+#include "func/func.hpp"
+#include <sstream>
+
+int main(int vargsc, char * vargs[]) {
+  if (vargsc != 2)
+    return 1;
+
+  registerNative("hypot", 2, [](GCMain &gc, Environment &env,
+        const TokenPos &pos, const std::vector<Value> &args) {
+    if (!args[0].isNum() || !args[1].isNum())
+      return Value(reportSyntaxError(*env.lexer, "hypot expects nums.", pos));
+
+    return Value::fromNum(std::hypot(args[0].getNum(), args[1].getNum()));
+  });
+
+  registerNative("clamp", 3, [](GCMain &gc, Environment &env,
+        const TokenPos &pos, const std::vector<Value> &args) {
+    if (!args[0].isInt() || !args[1].isInt() || !args[2].isInt())
+      return Value(reportSyntaxError(*env.lexer, "clamp expects ints.", pos));
+
+    return Value::fromInt(std::max(args[0].getInt(),
+          std::min(args[1].getInt(), args[2].getInt())));
+  });
+
+  registerNative("is_atom", 1, [](GCMain &gc, Environment &env,
+        const TokenPos &pos, const std::vector<Value> &args) {
+    return Value::fromBool(args[0].isAtom());
+  });
+
+  registerNative("is_bool", 1, [](GCMain &gc, Environment &env,
+        const TokenPos &pos, const std::vector<Value> &args) {
+    return Value::fromBool(args[0].isBool());
+  });
+
+  std::vector<std::string> lines;
+  GCMain gc;
+  Environment *env = new Environment(gc);
+
+  std::istringstream istrstream(vargs[1]);
+  return interpret(istrstream, gc, lines, env) ? 0 : 1;
+}
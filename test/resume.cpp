@@ -0,0 +1,89 @@
+/**
+ * test/resume.cpp
+ * -----------------------------------------------------------------------------
+ * Interprets the file (first argument) and then evaluates the expressions
+ * (further arguments) interleaved on one thread: Every evaluation is resumed
+ * for the given count of reduction steps (second argument) in turn. Writes
+ * the results in the order the evaluations finished.
+ *
+ * --sample runs the sampling profiler and checks, that the suspended
+ * evaluations leave no frames on the shadow stack of the host.
+ *
+ * Usage: resume [--sample] <file> <steps> <expressions>...
+ */
+
+#include "func/func.hpp"
+#include <sstream>
+
+int main(int vargsc, char * vargs[]) {
+  std::unique_ptr<Sampler> sampler;
+  if (vargsc > 1 && std::string(vargs[1]) == "--sample") {
+    sampler.reset(new Sampler());
+    --vargsc;
+    ++vargs;
+  }
+
+  if (vargsc < 4)
+    return 1;
+
+  std::vector<std::string> lines;
+  GCMain gc;
+  Environment *env = new Environment(gc);
+
+  std::ifstream input(vargs[1]);
+  if (!input) {
+    std::cerr << "Failed opening file \"" << vargs[1] << "\"." << std::endl;
+    return 1;
+  }
+
+  if (!interpret(input, gc, lines, env))
+    return 1;
+
+  std::size_t steps = std::atoi(vargs[2]);
+
+  // Lexers must live as long as the evaluations (reporting errors)
+  std::vector<std::unique_ptr<std::istringstream>> inputs;
+  std::vector<std::unique_ptr<Lexer>> lexers;
+  std::vector<std::unique_ptr<Evaluation>> evaluations;
+  for (int i = 3; i < vargsc; ++i) {
+    inputs.emplace_back(new std::istringstream(vargs[i]));
+    lexers.emplace_back(new Lexer(*inputs.back(), lines));
+    env->lexer = lexers.back().get();
+
+    lexers.back()->nextToken();
+    Expr *expr = parse(gc, *lexers.back(), *env);
+    if (!expr)
+      return 1;
+
+    evaluations.emplace_back(new Evaluation(gc, *env, expr));
+  }
+
+  bool success = true;
+  std::size_t running = evaluations.size();
+  for (std::size_t round = 0; running > 0; ++round) {
+    for (std::size_t i = 0; i < evaluations.size(); ++i) {
+      if (evaluations[i]->isDone())
+        continue;
+
+      bool done = evaluations[i]->resume(steps);
+      if (getShadowDepth() != 0) {
+        std::cerr << "Shadow stack not restored." << std::endl;
+        return 1;
+      }
+
+      if (!done)
+        continue;
+
+      --running;
+      Expr *result = evaluations[i]->getResult();
+      success = success && result;
+      std::cout << i << ": " << (result ? "=> " + result->toString() : "error")
+        << " (" << evaluations[i]->getSteps() << " steps, round " << round
+        << ")" << std::endl;
+    }
+
+    collectGarbage(gc, *env);
+  }
+
+  return success ? 0 : 1;
+}